@@ -7,6 +7,7 @@
 #include "AutoSupportModLocalPlayerSubsystem.h"
 #include "AutoSupportModSubsystem.h"
 #include "FGBuildGun.h"
+#include "FGBuildGunBuild.h"
 #include "FGBuildGunDismantle.h"
 #include "NativeHookManager.h"
 #include "Common/ModLogging.h"
@@ -34,10 +35,15 @@ void FAutoSupportModule::RegisterHooks()
 
 	SUBSCRIBE_UOBJECT_METHOD(AFGBuildable, EndPlay, [](auto& Scope, AFGBuildable* Buildable, const EEndPlayReason::Type EndType)
 	{
-		if (EndType == EEndPlayReason::Type::Destroyed && Buildable->ShouldConvertToLightweight()) 
+		if (EndType != EEndPlayReason::Type::Destroyed || !Buildable->ShouldConvertToLightweight())
+		{
+			return;
+		}
+
+		// Most removed buildables have nothing to do with supports. The filter rejects those before any map lookup.
+		if (auto* SupportSubsys = AAutoSupportModSubsystem::Get(Buildable->GetWorld()); SupportSubsys && SupportSubsys->MayBeRegistered(Buildable)) 
 		{
 			// call our subsys delegate in this case b/c it isn't working. This is to solve not catching removals on individual buildables for support proxys.
-			auto* SupportSubsys = AAutoSupportModSubsystem::Get(Buildable->GetWorld());
 			SupportSubsys->OnWorldBuildableRemoved(Buildable);
 		}
 	});
@@ -72,15 +78,49 @@ void FAutoSupportModule::RegisterHooks()
 		}
 	});
 
+	SUBSCRIBE_UOBJECT_METHOD(UFGBuildGunStateDismantle, PrimaryFire_Implementation, [&](auto& Scope, UFGBuildGunStateDismantle* State)
+	{
+		if (IsValid(State))
+		{
+			auto* Module = UAutoSupportBuildGunExtensionsModule::Get(State->GetWorld());
+			fgcheck(IsValid(Module));
+			
+			if (Module->OnBuildGunDismantlePrimaryFire(State))
+			{
+				Scope.Cancel();
+			}
+		}
+	});
+
 	SUBSCRIBE_UOBJECT_METHOD_AFTER(UFGBuildGunStateDismantle, TickState_Implementation, [&](UFGBuildGunStateDismantle* State, float DeltaTime)
 	{
 		if (IsValid(State))
 		{
-			const auto* Module = UAutoSupportBuildGunExtensionsModule::Get(State->GetWorld());
+			auto* Module = UAutoSupportBuildGunExtensionsModule::Get(State->GetWorld());
 			fgcheck(IsValid(Module));
 			Module->OnBuildGunDismantleStateTick(State);
 		}
 	});
+
+	SUBSCRIBE_UOBJECT_METHOD_AFTER(UFGBuildGunStateBuild, TickState_Implementation, [&](UFGBuildGunStateBuild* State, float DeltaTime)
+	{
+		if (IsValid(State))
+		{
+			auto* Module = UAutoSupportBuildGunExtensionsModule::Get(State->GetWorld());
+			fgcheck(IsValid(Module));
+			Module->OnBuildGunBuildStateTick(State);
+		}
+	});
+
+	SUBSCRIBE_UOBJECT_METHOD_AFTER(UFGBuildGunStateBuild, EndState_Implementation, [&](UFGBuildGunStateBuild* State)
+	{
+		if (IsValid(State))
+		{
+			auto* Module = UAutoSupportBuildGunExtensionsModule::Get(State->GetWorld());
+			fgcheck(IsValid(Module));
+			Module->OnBuildGunBuildStateEnd(State);
+		}
+	});
 }
 
 #undef LOCTEXT_NAMESPACE
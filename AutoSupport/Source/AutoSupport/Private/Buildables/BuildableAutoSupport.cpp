@@ -6,7 +6,9 @@
 #include "AutoSupportModLocalPlayerSubsystem.h"
 #include "AutoSupportModSubsystem.h"
 #include "BP_ModConfig_AutoSupportStruct.h"
+#include "BuildableAutoSupportPreviewComponent.h"
 #include "BuildableAutoSupportProxy.h"
+#include "BuildableAutoSupportRegion.h"
 #include "DrawDebugHelpers.h"
 #include "FGBlueprintProxy.h"
 #include "FGBuildingDescriptor.h"
@@ -21,13 +23,32 @@
 
 ABuildableAutoSupport::ABuildableAutoSupport(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
+	PreviewComponent = CreateDefaultSubobject<UBuildableAutoSupportPreviewComponent>(TEXT("PreviewComponent"));
+	PreviewComponent->SetupAttachment(RootComponent);
 }
 
 bool ABuildableAutoSupport::TraceAndCreatePlan(APawn* BuildInstigator, FAutoSupportBuildPlan& OutPlan) const
 {
 	OutPlan = FAutoSupportBuildPlan();
 
+	if (!CanCreatePlan(OutPlan))
+	{
+		return false;
+	}
+	
+	// Trace to know how much we're going to build.
+	return CreatePlanFromTrace(BuildInstigator, Trace(), OutPlan);
+}
+
+bool ABuildableAutoSupport::CanCreatePlan(FAutoSupportBuildPlan& OutPlan) const
+{
 	// IMPORTANT: This ticks while the interact dialog is open.
+	if (AutoSupportData.HasPendingDescriptors())
+	{
+		MOD_TRACE_LOG(Verbose, TEXT("Part descriptors are still loading."));
+		return false;
+	}
+	
 	if (!AutoSupportData.MiddlePartDescriptor.IsValid() && !AutoSupportData.StartPartDescriptor.IsValid() && !AutoSupportData.EndPartDescriptor.IsValid())
 	{
 		MOD_TRACE_LOG(Verbose, TEXT("Nothing to build!"));
@@ -40,21 +61,44 @@ bool ABuildableAutoSupport::TraceAndCreatePlan(APawn* BuildInstigator, FAutoSupp
 		OutPlan.BuildDisqualifiers.Add(UFGCDIntersectingBlueprintDesigner::StaticClass());
 		return false;
 	}
-	
-	// Trace to know how much we're going to build.
-	const auto TraceResult = Trace();
-	
+
+	return true;
+}
+
+bool ABuildableAutoSupport::CreatePlanFromTrace(APawn* BuildInstigator, const FAutoSupportTraceResult& TraceResult, FAutoSupportBuildPlan& OutPlan) const
+{
 	UAutoSupportBlueprintLibrary::PlanBuild(GetWorld(), TraceResult, AutoSupportData, OutPlan);
+	UpdatePlanAffordability(BuildInstigator, OutPlan);
 
+	return OutPlan.IsActionable();
+}
+
+void ABuildableAutoSupport::UpdatePlanAffordability(APawn* BuildInstigator, FAutoSupportBuildPlan& Plan)
+{
 	auto* Player = CastChecked<AFGCharacterPlayer>(BuildInstigator);
+	
+	Plan.BuildDisqualifiers.Remove(UFGCDUnaffordable::StaticClass());
 
-	if (!UAutoSupportBlueprintLibrary::CanAffordItemBill(Player, OutPlan.ItemBill, true))
+	if (!UAutoSupportBlueprintLibrary::CanAffordItemBill(Player, Plan.ItemBill, true))
 	{
 		MOD_TRACE_LOG(Verbose, TEXT("Cannot afford item bill."));
-		OutPlan.BuildDisqualifiers.Add(UFGCDUnaffordable::StaticClass());
+		Plan.BuildDisqualifiers.Add(UFGCDUnaffordable::StaticClass());
 	}
+}
 
-	return OutPlan.IsActionable();
+bool ABuildableAutoSupport::IsSameTrace(const FAutoSupportTraceResult& A, const FAutoSupportTraceResult& B)
+{
+	// Exact, the plan is made from these values.
+	return A.BuildDistance == B.BuildDistance
+		&& A.IsLandscapeHit == B.IsLandscapeHit
+		&& A.StartLocation == B.StartLocation
+		&& A.Direction == B.Direction
+		&& A.BuildDirection == B.BuildDirection
+		&& A.Disqualifier == B.Disqualifier
+		&& A.EndHitResult.bBlockingHit == B.EndHitResult.bBlockingHit
+		&& A.EndHitResult.ImpactPoint == B.EndHitResult.ImpactPoint
+		&& A.EndHitResult.ImpactNormal == B.EndHitResult.ImpactNormal
+		&& A.EndHitResult.GetComponent() == B.EndHitResult.GetComponent();
 }
 
 void ABuildableAutoSupport::BuildSupports(APawn* BuildInstigator)
@@ -73,35 +117,95 @@ void ABuildableAutoSupport::BuildSupports(APawn* BuildInstigator)
 		return;
 	}
 	
-	// Construct
+	const auto ProxyTransform = UAutoSupportBlueprintLibrary::GetPlanProxyTransform(Plan, this);
+	FAutoSupportPreparedBuild Build;
+
+	if (IsCachedPreparedBuildCurrent(Plan, ProxyTransform))
+	{
+		// The cube is destroyed once built, the cached build isn't needed after.
+		Build = MoveTemp(CachedPreparedBuild);
+		MOD_LOG(Verbose, TEXT("Committing the cached prepared build."))
+	}
+	else
+	{
+		UAutoSupportBlueprintLibrary::PrepareBuild(Plan, ProxyTransform, Build);
+	}
+	
+	const auto* BuildConfig = UAutoSupportBuildConfigModule::Get(GetWorld());
+	
+	if (Build.Parts.Num() == 1 && BuildConfig && BuildConfig->bSkipProxyForSinglePartSupports)
+	{
+		const auto* Buildable = CommitPreparedSinglePart(Build, BuildInstigator);
+		
+		MOD_LOG(Verbose, TEXT("Completed single part, Buildable transform: [%s]"), *Buildable->GetActorTransform().ToHumanReadableString());
+	}
+	else if (BuildConfig && BuildConfig->bStoreSupportsInRegions && AutoSupportRegionClass)
+	{
+		const auto* Region = CommitPreparedBuildToRegion(Build, BuildInstigator);
+
+		MOD_LOG(Verbose, TEXT("Completed, Region: [%s], Records: [%i]"), TEXT_ACTOR_NAME(Region), Region->NumRecords());
+	}
+	else
+	{
+		const auto* SupportProxy = CommitPreparedBuild(Build, BuildInstigator);
+	
+		MOD_LOG(Verbose, TEXT("Completed, SupportProxy transform: [%s]"), *SupportProxy->GetActorTransform().ToHumanReadableString());
+	}
+	
+	// Dismantle self
+	Destroy();
+}
+
+bool ABuildableAutoSupport::IsCachedPreparedBuildCurrent(const FAutoSupportBuildPlan& Plan, const FTransform& ProxyTransform) const
+{
+	// Nothing cached where no preview runs, such as on the server for a remote player.
+	if (CachedPreparedBuild.Parts.IsEmpty() || !CachedPreparedBuild.ProxyTransform.Equals(ProxyTransform, 0))
+	{
+		return false;
+	}
+
+	if (CachedPlan.BuildDirection != Plan.BuildDirection
+		|| CachedPlan.RelativeLocation != Plan.RelativeLocation
+		|| !CachedPlan.RelativeRotation.Equals(Plan.RelativeRotation, 0)
+		|| CachedPlan.StartWorldLocation != Plan.StartWorldLocation
+		|| CachedPlan.BuildWorldDirection != Plan.BuildWorldDirection
+		|| CachedPlan.EndPartPositionOffset != Plan.EndPartPositionOffset)
+	{
+		return false;
+	}
+
+	// Exact, the same trace over the same world gives the same plan. Anything that moved since the last preview refresh prepares anew.
+	const auto* PartStruct = FAutoSupportBuildPlanPartData::StaticStruct();
+	
+	return PartStruct->CompareScriptStruct(&CachedPlan.StartPart, &Plan.StartPart, PPF_None)
+		&& PartStruct->CompareScriptStruct(&CachedPlan.MidPart, &Plan.MidPart, PPF_None)
+		&& PartStruct->CompareScriptStruct(&CachedPlan.EndPart, &Plan.EndPart, PPF_None);
+}
+
+ABuildableAutoSupportProxy* ABuildableAutoSupport::CommitPreparedBuild(const FAutoSupportPreparedBuild& Build, APawn* BuildInstigator)
+{
 	auto* Buildables = AFGBuildableSubsystem::Get(GetWorld());
 	auto* LightBuildables = AFGLightweightBuildableSubsystem::Get(GetWorld());
 	
 	ABuildableAutoSupportProxy* SupportProxy = nullptr;
-	auto* RootHologram = UAutoSupportBlueprintLibrary::CreateCompositeHologramFromPlan(Plan, AutoSupportProxyClass, BuildInstigator, this, this, SupportProxy);
+	auto* RootHologram = UAutoSupportBlueprintLibrary::CreateCompositeHologramFromPreparedBuild(Build, AutoSupportProxyClass, BuildInstigator, this, SupportProxy);
 	
 	TArray<AActor*> HologramSpawnedActors;
 	auto* StartBuildable = CastChecked<AFGBuildable>(RootHologram->Construct(HologramSpawnedActors, Buildables->GetNewNetConstructionID()));
 	HologramSpawnedActors.Insert(StartBuildable, 0);
 
-	// TODO(k.a): see if supports can be included in a blueprint proxy
-	// auto* BlueprintProxy = GetBlueprintProxy();
-
-	int32 i = 0;
-	for (auto* HologramSpawnedActor : HologramSpawnedActors)
-	{
-		auto* Buildable = CastChecked<AFGBuildable>(HologramSpawnedActor);
+	// The holograms construct in the order they were spawned, which is the prepared part order.
+	fgcheck(HologramSpawnedActors.Num() == Build.Parts.Num())
 
-		auto CustomizationData = Plan.MidPart.CustomizationData;
+	// Supports built from a blueprint become part of it so they are saved and dismantled with it. The parts are then owned by both proxies,
+	// see ABuildableAutoSupportProxy::BlueprintProxy for how either side dismantles them.
+	auto* BlueprintProxy = GetBlueprintProxy();
+	SupportProxy->SetBlueprintProxy(BlueprintProxy);
 
-		if (i == 0)
-		{
-			CustomizationData = Plan.StartPart.CustomizationData;
-		}
-		else if (i == HologramSpawnedActors.Num() - 1)
-		{
-			CustomizationData = Plan.EndPart.CustomizationData;
-		}
+	for (auto i = 0; i < HologramSpawnedActors.Num(); ++i)
+	{
+		auto* Buildable = CastChecked<AFGBuildable>(HologramSpawnedActors[i]);
+		const auto& CustomizationData = Build.Parts[i].CustomizationData;
 		
 		Buildable->SetCustomizationData_Native(CustomizationData);
 		if (Buildable->ManagedByLightweightBuildableSubsystem()) // TODO(k.a): check colorable?
@@ -111,18 +215,10 @@ void ABuildableAutoSupport::BuildSupports(APawn* BuildInstigator)
 		
 		SupportProxy->RegisterBuildable(Buildable);
 
-		// TODO(k.a): crashing on dismantle
-		// if (BlueprintProxy)
-		// {
-		// 	if (Buildable->ShouldConvertToLightweight())
-		// 	{
-		// 		BlueprintProxy->RegisterLightweightInstance(Buildable->GetClass(), Buildable->GetRuntimeDataIndex());
-		// 	}
-		// 	else
-		// 	{
-		// 		BlueprintProxy->RegisterBuildable(Buildable);
-		// 	}
-		// }
+		if (BlueprintProxy)
+		{
+			RegisterWithBlueprintProxy(BlueprintProxy, Buildable);
+		}
 		
 		MOD_LOG(
 			Verbose,
@@ -132,17 +228,243 @@ void ABuildableAutoSupport::BuildSupports(APawn* BuildInstigator)
 			TEXT_CONDITION(Buildable->ShouldConvertToLightweight()),
 			TEXT_CONDITION(Buildable->ManagedByLightweightBuildableSubsystem()),
 			CustomizationData.SwatchDesc ? *(CustomizationData.SwatchDesc->GetName()) : TEXT_EMPTY);
-		++i;
 	}
 
 	SupportProxy->FinishSpawning(SupportProxy->GetActorTransform());
+
+	return SupportProxy;
+}
+
+ABuildableAutoSupportRegion* ABuildableAutoSupport::CommitPreparedBuildToRegion(const FAutoSupportPreparedBuild& Build, APawn* BuildInstigator)
+{
+	auto* Buildables = AFGBuildableSubsystem::Get(GetWorld());
+	auto* LightBuildables = AFGLightweightBuildableSubsystem::Get(GetWorld());
 	
-	MOD_LOG(Verbose, TEXT("Completed, SupportProxy transform: [%s]"), *SupportProxy->GetActorTransform().ToHumanReadableString());
+	auto* RootHologram = UAutoSupportBlueprintLibrary::CreateWorldCompositeHologramFromPreparedBuild(Build, BuildInstigator, this);
 	
-	// Dismantle self
-	Destroy();
+	TArray<AActor*> HologramSpawnedActors;
+	auto* StartBuildable = CastChecked<AFGBuildable>(RootHologram->Construct(HologramSpawnedActors, Buildables->GetNewNetConstructionID()));
+	HologramSpawnedActors.Insert(StartBuildable, 0);
+
+	fgcheck(HologramSpawnedActors.Num() == Build.Parts.Num())
+
+	auto* BlueprintProxy = GetBlueprintProxy();
+	TArray<AFGBuildable*> BuiltParts;
+	BuiltParts.Reserve(HologramSpawnedActors.Num());
+
+	for (auto i = 0; i < HologramSpawnedActors.Num(); ++i)
+	{
+		auto* Buildable = CastChecked<AFGBuildable>(HologramSpawnedActors[i]);
+		
+		Buildable->SetCustomizationData_Native(Build.Parts[i].CustomizationData);
+		if (Buildable->ManagedByLightweightBuildableSubsystem())
+		{
+			LightBuildables->CopyCustomizationDataFromTemporaryToInstance(Buildable);
+		}
+
+		if (BlueprintProxy)
+		{
+			RegisterWithBlueprintProxy(BlueprintProxy, Buildable);
+		}
+		
+		BuiltParts.Add(Buildable);
+	}
+
+	auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld());
+	
+	return SupportSubsys->AddSupportToRegion(AutoSupportRegionClass, Build.ProxyTransform, Build.LocalBounds, BuiltParts);
+}
+
+void ABuildableAutoSupport::RefreshBuildPreview()
+{
+	auto* Instigator = BuildPreviewInstigator.Get();
+	
+	if (!Instigator || NumBuildPreviewRequests <= 0)
+	{
+		bHasPreviewTrace = false;
+		PreviewComponent->ClearPreview();
+		return;
+	}
+
+	FAutoSupportBuildPlan Plan;
+	
+	if (!CanCreatePlan(Plan))
+	{
+		bHasPreviewTrace = false;
+		CachedPlan = MoveTemp(Plan);
+		PreviewComponent->ClearPreview();
+		return;
+	}
+
+	// Only the trace runs every refresh. Planning and preparing are skipped while it hits the same, the preview already shows that plan.
+	const auto TraceResult = Trace();
+	
+	if (bHasPreviewTrace
+		&& IsSameTrace(TraceResult, PreviewTraceResult)
+		&& FBuildableAutoSupportData::StaticStruct()->CompareScriptStruct(&AutoSupportData, &PreviewTraceData, PPF_None))
+	{
+		// The inventory may have changed since.
+		UpdatePlanAffordability(Instigator, CachedPlan);
+		return;
+	}
+
+	PreviewTraceResult = TraceResult;
+	PreviewTraceData = AutoSupportData;
+	bHasPreviewTrace = true;
+	
+	CreatePlanFromTrace(Instigator, TraceResult, Plan);
+	CachedPlan = MoveTemp(Plan);
+
+	if (CachedPlan.MidPart.IsUnspecified() && CachedPlan.StartPart.IsUnspecified() && CachedPlan.EndPart.IsUnspecified())
+	{
+		PreviewComponent->ClearPreview();
+		return;
+	}
+
+	// A changed plan only rewrites the instance transforms of the meshes already shown.
+	UAutoSupportBlueprintLibrary::PrepareBuild(CachedPlan, UAutoSupportBlueprintLibrary::GetPlanProxyTransform(CachedPlan, this), CachedPreparedBuild);
+	
+	PreviewComponent->ShowParts(CachedPreparedBuild.Parts, CachedPreparedBuild.ProxyTransform);
+}
+
+void ABuildableAutoSupport::AddBuildPreviewRequest(APawn* PreviewInstigator)
+{
+	if (!PreviewInstigator || !PreviewInstigator->IsLocallyControlled())
+	{
+		return;
+	}
+	
+	BuildPreviewInstigator = PreviewInstigator;
+	++NumBuildPreviewRequests;
+
+	MOD_LOG(Verbose, TEXT("Preview requested. Requests: [%i]"), NumBuildPreviewRequests)
+
+	if (NumBuildPreviewRequests == 1)
+	{
+		RefreshBuildPreview();
+		GetWorldTimerManager().SetTimer(BuildPreviewRefreshTimerHandle, this, &ABuildableAutoSupport::RefreshBuildPreview, BuildPreviewRefreshInterval, true);
+	}
 }
 
+void ABuildableAutoSupport::RemoveBuildPreviewRequest()
+{
+	if (NumBuildPreviewRequests <= 0)
+	{
+		return;
+	}
+	
+	--NumBuildPreviewRequests;
+
+	MOD_LOG(Verbose, TEXT("Preview request removed. Requests: [%i]"), NumBuildPreviewRequests)
+
+	if (NumBuildPreviewRequests == 0)
+	{
+		GetWorldTimerManager().ClearTimer(BuildPreviewRefreshTimerHandle);
+		BuildPreviewInstigator.Reset();
+		bHasPreviewTrace = false;
+		PreviewComponent->ClearPreview();
+	}
+}
+
+AFGBuildable* ABuildableAutoSupport::CommitPreparedSinglePart(const FAutoSupportPreparedBuild& Build, APawn* BuildInstigator)
+{
+	fgcheck(Build.Parts.Num() == 1)
+	
+	const auto& Part = Build.Parts[0];
+	const auto WorldTransform = Part.RelativeTransform * Build.ProxyTransform;
+	
+	auto* Buildables = AFGBuildableSubsystem::Get(GetWorld());
+	auto* LightBuildables = AFGLightweightBuildableSubsystem::Get(GetWorld());
+
+	auto* Hologram = AFGHologram::SpawnHologramFromRecipe(
+		Part.BuildRecipeClass,
+		this,
+		WorldTransform.GetLocation(),
+		BuildInstigator,
+		[&WorldTransform](AFGHologram* PreSpawnHolo)
+		{
+			PreSpawnHolo->SetActorRotation(WorldTransform.GetRotation());
+			PreSpawnHolo->DoMultiStepPlacement(false);
+		});
+
+	TArray<AActor*> HologramSpawnedActors;
+	auto* Buildable = CastChecked<AFGBuildable>(Hologram->Construct(HologramSpawnedActors, Buildables->GetNewNetConstructionID()));
+
+	Buildable->SetCustomizationData_Native(Part.CustomizationData);
+	if (Buildable->ManagedByLightweightBuildableSubsystem())
+	{
+		LightBuildables->CopyCustomizationDataFromTemporaryToInstance(Buildable);
+	}
+
+	if (auto* BlueprintProxy = GetBlueprintProxy())
+	{
+		RegisterWithBlueprintProxy(BlueprintProxy, Buildable);
+	}
+
+	auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld());
+	SupportSubsys->RegisterSinglePartSupport(Buildable);
+
+	return Buildable;
+}
+
+void ABuildableAutoSupport::RegisterWithBlueprintProxy(AFGBlueprintProxy* BlueprintProxy, AFGBuildable* Buildable)
+{
+	if (!Buildable->ManagedByLightweightBuildableSubsystem())
+	{
+		BlueprintProxy->RegisterBuildable(Buildable);
+		return;
+	}
+
+	// Lightweights are registered by their instance, the temporary is cleaned up after construction.
+	const auto RuntimeIndex = Buildable->GetRuntimeDataIndex();
+	
+	if (RuntimeIndex == INDEX_NONE)
+	{
+		MOD_LOG(Warning, TEXT("Lightweight buildable [%s] has no runtime index. Not registering with the blueprint proxy."), TEXT_ACTOR_NAME(Buildable))
+		return;
+	}
+	
+	BlueprintProxy->RegisterLightweightInstance(Buildable->GetClass(), RuntimeIndex);
+}
+
+#pragma region IFGUseableInterface
+
+void ABuildableAutoSupport::StartIsLookedAt_Implementation(AFGCharacterPlayer* byCharacter, const FUseState& state)
+{
+	Super::StartIsLookedAt_Implementation(byCharacter, state);
+
+	AddBuildPreviewRequest(byCharacter);
+}
+
+void ABuildableAutoSupport::StopIsLookedAt_Implementation(AFGCharacterPlayer* byCharacter, const FUseState& state)
+{
+	Super::StopIsLookedAt_Implementation(byCharacter, state);
+
+	if (byCharacter && byCharacter->IsLocallyControlled())
+	{
+		RemoveBuildPreviewRequest();
+	}
+}
+
+void ABuildableAutoSupport::RegisterInteractingPlayer_Implementation(AFGCharacterPlayer* player)
+{
+	Super::RegisterInteractingPlayer_Implementation(player);
+
+	AddBuildPreviewRequest(player);
+}
+
+void ABuildableAutoSupport::UnregisterInteractingPlayer_Implementation(AFGCharacterPlayer* player)
+{
+	Super::UnregisterInteractingPlayer_Implementation(player);
+
+	if (player && player->IsLocallyControlled())
+	{
+		RemoveBuildPreviewRequest();
+	}
+}
+
+#pragma endregion
+
 #pragma region IFGSaveInterface
 
 bool ABuildableAutoSupport::ShouldSave_Implementation() const
@@ -153,16 +475,12 @@ bool ABuildableAutoSupport::ShouldSave_Implementation() const
 void ABuildableAutoSupport::PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
 {
 	Super::PreSaveGame_Implementation(saveVersion, gameVersion);
-	
-	AutoSupportData.ClearInvalidReferences();
 }
 
 // This is called before BeginPlay (even when not loading a game)
 void ABuildableAutoSupport::PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
 {
 	Super::PostLoadGame_Implementation(saveVersion, gameVersion);
-	
-	AutoSupportData.ClearInvalidReferences();
 }
 
 #pragma endregion
@@ -222,6 +540,32 @@ void ABuildableAutoSupport::BeginPlay()
 	}
 
 	bAutoConfigureAtBeginPlay = false;
+
+	PreloadDescriptors();
+}
+
+void ABuildableAutoSupport::PreloadDescriptors()
+{
+	auto* Subsystem = AAutoSupportModSubsystem::Get(GetWorld());
+
+	if (!Subsystem)
+	{
+		return;
+	}
+
+	// Invalid references are cleared once loaded. Clearing before that would drop descriptors that are still loading.
+	Subsystem->PreloadDescriptors(AutoSupportData, FStreamableDelegate::CreateWeakLambda(this, [this]
+	{
+		AutoSupportData.ClearInvalidReferences();
+	}));
+}
+
+void ABuildableAutoSupport::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(BuildPreviewRefreshTimerHandle);
+	NumBuildPreviewRequests = 0;
+	
+	Super::EndPlay(EndPlayReason);
 }
 
 #pragma region Editor Only
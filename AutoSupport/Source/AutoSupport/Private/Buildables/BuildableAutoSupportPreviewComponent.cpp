@@ -0,0 +1,168 @@
+﻿//
+
+#include "BuildableAutoSupportPreviewComponent.h"
+
+#include "FGBuildable.h"
+#include "ModLogging.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+UBuildableAutoSupportPreviewComponent::UBuildableAutoSupportPreviewComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetMobility(EComponentMobility::Movable);
+}
+
+void UBuildableAutoSupportPreviewComponent::ShowParts(const TArray<FAutoSupportPlannedPart>& Parts, const FTransform& ProxyTransform)
+{
+	if (IsShowing(Parts, ProxyTransform))
+	{
+		return;
+	}
+
+	// Gather the world transform of every mesh instance, grouped by mesh.
+	TMap<UStaticMesh*, TArray<FTransform>> TransformsByMesh;
+	TMap<UClass*, TArray<FInstanceData>> MeshDataByClass;
+
+	for (const auto& Part : Parts)
+	{
+		if (!Part.BuildableClass)
+		{
+			continue;
+		}
+
+		auto* MeshData = MeshDataByClass.Find(Part.BuildableClass);
+		if (!MeshData)
+		{
+			auto* BuildableCDO = Part.BuildableClass->GetDefaultObject<AFGBuildable>();
+			MeshData = &MeshDataByClass.Add(Part.BuildableClass, BuildableCDO->GetActorLightweightInstanceData_Implementation());
+		}
+
+		const auto PartWorldTransform = Part.RelativeTransform * ProxyTransform;
+
+		for (const auto& InstanceData : *MeshData)
+		{
+			if (InstanceData.StaticMesh)
+			{
+				TransformsByMesh.FindOrAdd(InstanceData.StaticMesh).Add(InstanceData.RelativeTransform * PartWorldTransform);
+			}
+		}
+	}
+
+	// Reuse the instances we have, only adding or removing the difference in count.
+	for (const auto& Entry : TransformsByMesh)
+	{
+		auto* Instances = FindOrCreateInstances(Entry.Key);
+		const auto& Transforms = Entry.Value;
+		const auto NumExisting = Instances->GetInstanceCount();
+
+		if (NumExisting > Transforms.Num())
+		{
+			for (auto i = NumExisting - 1; i >= Transforms.Num(); --i)
+			{
+				Instances->RemoveInstance(i);
+			}
+		}
+
+		const auto NumToUpdate = FMath::Min(NumExisting, Transforms.Num());
+		if (NumToUpdate > 0)
+		{
+			Instances->BatchUpdateInstancesTransforms(0, MakeArrayView(Transforms.GetData(), NumToUpdate), true, true, true);
+		}
+
+		if (Transforms.Num() > NumExisting)
+		{
+			Instances->AddInstances(TArray<FTransform>(Transforms.GetData() + NumExisting, Transforms.Num() - NumExisting), false, true);
+		}
+	}
+
+	for (const auto& Entry : InstancesByMesh)
+	{
+		if (!TransformsByMesh.Contains(Entry.Key) && Entry.Value && Entry.Value->GetInstanceCount() > 0)
+		{
+			Entry.Value->ClearInstances();
+		}
+	}
+
+	ShownParts = Parts;
+	ShownProxyTransform = ProxyTransform;
+
+	MOD_LOG(VeryVerbose, TEXT("Showing %i parts using %i meshes."), Parts.Num(), TransformsByMesh.Num())
+}
+
+void UBuildableAutoSupportPreviewComponent::ClearPreview()
+{
+	for (const auto& Entry : InstancesByMesh)
+	{
+		if (Entry.Value)
+		{
+			Entry.Value->ClearInstances();
+		}
+	}
+
+	ShownParts.Empty();
+}
+
+UInstancedStaticMeshComponent* UBuildableAutoSupportPreviewComponent::FindOrCreateInstances(UStaticMesh* Mesh)
+{
+	if (const auto* Existing = InstancesByMesh.Find(Mesh); Existing && *Existing)
+	{
+		return *Existing;
+	}
+
+	auto* Instances = NewObject<UInstancedStaticMeshComponent>(GetOwner(), NAME_None, RF_Transient);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetStaticMesh(Mesh);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetCastShadow(false);
+	Instances->SetRenderInMainPass(!bOutlineOnly);
+	Instances->SetRenderCustomDepth(bOutlineOnly);
+	Instances->SetupAttachment(this);
+
+	if (PreviewMaterial)
+	{
+		for (auto i = 0; i < Instances->GetNumMaterials(); ++i)
+		{
+			Instances->SetMaterial(i, PreviewMaterial);
+		}
+	}
+
+	Instances->RegisterComponent();
+	InstancesByMesh.Add(Mesh, Instances);
+
+	return Instances;
+}
+
+bool UBuildableAutoSupportPreviewComponent::IsShowing(const TArray<FAutoSupportPlannedPart>& Parts, const FTransform& ProxyTransform) const
+{
+	if (ShownParts.Num() != Parts.Num() || !ShownProxyTransform.Equals(ProxyTransform))
+	{
+		return false;
+	}
+
+	for (auto i = 0; i < Parts.Num(); ++i)
+	{
+		if (!ShownParts[i].Equals(Parts[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UBuildableAutoSupportPreviewComponent::OnUnregister()
+{
+	for (const auto& Entry : InstancesByMesh)
+	{
+		if (Entry.Value)
+		{
+			Entry.Value->DestroyComponent();
+		}
+	}
+
+	InstancesByMesh.Empty();
+	ShownParts.Empty();
+
+	Super::OnUnregister();
+}
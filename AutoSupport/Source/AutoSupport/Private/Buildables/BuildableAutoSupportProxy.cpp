@@ -1,13 +1,17 @@
 ﻿// 
 
 #include "BuildableAutoSupportProxy.h"
+#include "AutoSupportBuildGunExtensionsModule.h"
 #include "AutoSupportModSubsystem.h"
+#include "BuildableAutoSupportPreviewComponent.h"
+#include "FGBlueprintProxy.h"
 #include "FGBuildable.h"
 #include "FGCharacterPlayer.h"
 #include "FGLightweightBuildableSubsystem.h"
 #include "ModBlueprintLibrary.h"
 #include "ModDebugBlueprintLibrary.h"
 #include "ModDefines.h"
+#include "ModDisqualifiers.h"
 #include "ModLogging.h"
 #include "Components/BoxComponent.h"
 
@@ -19,22 +23,39 @@ ABuildableAutoSupportProxy::ABuildableAutoSupportProxy()
 	BoundingBoxComponent = CreateDefaultSubobject<UBoxComponent>(TEXT("BoundingBoxComponent"));
 	BoundingBoxComponent->SetMobility(EComponentMobility::Type::Movable);
 	BoundingBoxComponent->SetupAttachment(RootComponent);
+
+	DismantleHighlightComponent = CreateDefaultSubobject<UBuildableAutoSupportPreviewComponent>(TEXT("DismantleHighlightComponent"));
+	DismantleHighlightComponent->SetupAttachment(RootComponent);
+	DismantleHighlightComponent->bOutlineOnly = true;
+}
+
+void ABuildableAutoSupportProxy::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+	
+	bImplementsK2UpdateBoundingBox = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ABuildableAutoSupportProxy, K2_UpdateBoundingBox));
+	bImplementsK2OnBuildModeUpdate = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ABuildableAutoSupportProxy, K2_OnBuildModeUpdate));
+
+	SetBuildModeState(EAutoSupportProxyBuildModeState::Inactive);
 }
 
 void ABuildableAutoSupportProxy::RegisterBuildable(AFGBuildable* Buildable)
 {
 	fgcheck(Buildable);
 	
-	const FAutoSupportBuildableHandle Handle(Buildable);
-	RegisteredHandles.Add(Handle);
+	const auto PartIndex = AddPart(Buildable->GetClass(), Buildable->GetTransform(), Buildable);
+	if (PartIndex == INDEX_NONE)
+	{
+		return;
+	}
 
 	if (Buildable->GetIsLightweightTemporary())
 	{
-		FLightweightBuildableInstanceRef InstanceRef;
-		InstanceRef.InitializeFromTemporary(Buildable);
-		
-		LightweightRefsByHandle.Add(Handle, InstanceRef);
+		LightweightRefs[PartIndex].InitializeFromTemporary(Buildable);
 	}
+
+	// Linked by the made handle, so the subsystem keys the part exactly as the proxy makes it from now on.
+	const auto Handle = MakeHandle(PartIndex);
 	
 	if (HasActorBegunPlay())
 	{
@@ -46,24 +67,40 @@ void ABuildableAutoSupportProxy::RegisterBuildable(AFGBuildable* Buildable)
 }
 
 // This is called by the auto support subsystem
-void ABuildableAutoSupportProxy::UnregisterBuildable(AFGBuildable* Buildable)
+void ABuildableAutoSupportProxy::UnregisterHandle(const FAutoSupportBuildableHandle& Handle)
+{
+	BeginDismantleTransaction();
+	PendingRemovedHandles.Add(Handle);
+}
+
+void ABuildableAutoSupportProxy::BeginDismantleTransaction()
 {
-	if (!Buildable)
+	if (bIsInDismantleTransaction)
 	{
 		return;
 	}
 
-	const FAutoSupportBuildableHandle Handle(Buildable);
-	
-	MOD_LOG(VeryVerbose, TEXT("Unregistering buildable. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+	bIsInDismantleTransaction = true;
+	AAutoSupportModSubsystem::Get(GetWorld())->QueueDismantleCommit(this);
+}
 
-	const auto NumRemoved = RegisteredHandles.Remove(Handle);
-	fgcheck(NumRemoved <= 1); // if we're removing more than 1, we've got problems.
-	
-	if (NumRemoved > 0)
+// This is called by the auto support subsystem
+void ABuildableAutoSupportProxy::CommitDismantleTransaction(TArray<FAutoSupportBuildableHandle>& OutRemovedHandles)
+{
+	bIsInDismantleTransaction = false;
+
+	// Everything marked is unlinked, even if it was already dropped as invalid.
+	OutRemovedHandles = PendingRemovedHandles.Array();
+
+	const auto ProxyTransform = GetActorTransform();
+	const auto NumRemoved = RemovePartsWhere([&](const int32 PartIndex)
 	{
-		DestroyIfEmpty(false);
-	}
+		return PendingRemovedHandles.Contains(MakeHandle(PartIndex, ProxyTransform));
+	});
+
+	PendingRemovedHandles.Reset();
+	
+	MOD_LOG(Verbose, TEXT("Committed dismantle transaction. Removed %i handles, %i remaining."), NumRemoved, GetNumParts())
 }
 
 void ABuildableAutoSupportProxy::UpdateBoundingBox(const FBox& NewBounds)
@@ -72,14 +109,69 @@ void ABuildableAutoSupportProxy::UpdateBoundingBox(const FBox& NewBounds)
 	BoundingBoxComponent->SetRelativeLocation(NewBounds.GetCenter());
 	BoundingBoxComponent->SetBoxExtent(NewBounds.GetExtent());
 
-	K2_UpdateBoundingBox(NewBounds);
+	if (bImplementsK2UpdateBoundingBox)
+	{
+		K2_UpdateBoundingBox(NewBounds);
+	}
+
+	if (HasActorBegunPlay())
+	{
+		AAutoSupportModSubsystem::Get(GetWorld())->UpdateProxyBounds(this);
+	}
+}
+
+FBox ABuildableAutoSupportProxy::GetWorldBounds() const
+{
+	return BoundingBox.TransformBy(GetActorTransform());
 }
 
 void ABuildableAutoSupportProxy::OnBuildModeUpdate(
 	TSubclassOf<UFGBuildGunModeDescriptor> BuildMode,
 	ULocalPlayer* LocalPlayer)
 {
-	K2_OnBuildModeUpdate(BuildMode, LocalPlayer);
+	AppliedBuildMode = BuildMode;
+	bHasAppliedBuildMode = true;
+
+	const auto* BuildGunExtensions = UAutoSupportBuildGunExtensionsModule::Get(GetWorld());
+	const auto bIsProxyDismantleMode = BuildMode && BuildGunExtensions && BuildMode == BuildGunExtensions->ProxyDismantleMode;
+	
+	SetBuildModeState(bIsProxyDismantleMode ? EAutoSupportProxyBuildModeState::Dismantle : EAutoSupportProxyBuildModeState::Inactive);
+
+	if (bImplementsK2OnBuildModeUpdate)
+	{
+		K2_OnBuildModeUpdate(BuildMode, LocalPlayer);
+	}
+}
+
+void ABuildableAutoSupportProxy::SetBuildModeState(const EAutoSupportProxyBuildModeState NewState)
+{
+	if (BuildModeState == NewState)
+	{
+		return;
+	}
+
+	BuildModeState = NewState;
+
+	// With shared collision, the proxy is aimed at through its instance in the cell's collision actor instead.
+	const auto* SupportSubsys = NewState == EAutoSupportProxyBuildModeState::Dismantle ? AAutoSupportModSubsystem::Get(GetWorld()) : nullptr;
+
+	if (SupportSubsys && !SupportSubsys->UsesSharedProxyCollision())
+	{
+		if (!DismantleCollisionProfileName.IsNone())
+		{
+			BoundingBoxComponent->SetCollisionProfileName(DismantleCollisionProfileName);
+		}
+		
+		BoundingBoxComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	}
+	else
+	{
+		BoundingBoxComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+#ifndef AUTOSUPPORT_DRAW_DEBUG_SHAPES
+	BoundingBoxComponent->SetHiddenInGame(NewState != EAutoSupportProxyBuildModeState::Dismantle || !bShowBoundingBoxInDismantleState);
+#endif
 }
 
 void ABuildableAutoSupportProxy::BeginPlay()
@@ -95,8 +187,9 @@ void ABuildableAutoSupportProxy::BeginPlay()
 	}
 	else
 	{
-		// This is done on the next tick because without it, there seems to be some initialization going on with the AbstractInstanceManager between now and trace complete that causes some traces not to return expected overlaps.
-		GetWorldTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &ABuildableAutoSupportProxy::BeginLoadTrace));
+		// Need to reestablish lightweight runtime indices. The subsystem does this for every loaded proxy at once.
+		bIsLoadResolvePending = true;
+		AAutoSupportModSubsystem::Get(GetWorld())->QueueLightweightResolve(this);
 	}
 
 #ifdef AUTOSUPPORT_DRAW_DEBUG_SHAPES
@@ -107,15 +200,15 @@ void ABuildableAutoSupportProxy::BeginPlay()
 
 void ABuildableAutoSupportProxy::EnsureBuildablesAvailable()
 {
-	if (bIsLoadTraceInProgress)
+	if (bIsLoadResolvePending)
 	{
-		MOD_LOG(Warning, TEXT("Invoked while load trace in progress. No-op."))
+		MOD_LOG(Warning, TEXT("Invoked while load resolve is pending. No-op."))
 		return;
 	}
 	
-	MOD_LOG(Verbose, TEXT("Ensuring buildables are available for %i buildables."), RegisteredHandles.Num())
+	MOD_LOG(Verbose, TEXT("Ensuring buildables are available for %i buildables."), GetNumParts())
 	
-	if (RegisteredHandles.Num() == 0)
+	if (GetNumParts() == 0)
 	{
 		bBuildablesAvailable = true;
 		return;
@@ -123,26 +216,23 @@ void ABuildableAutoSupportProxy::EnsureBuildablesAvailable()
 
 	RemoveInvalidHandles();
 	
-	for (auto i = 0; i < RegisteredHandles.Num(); ++i)
+	for (auto i = 0; i < GetNumParts(); ++i)
 	{
-		auto& Handle = RegisteredHandles[i];
+		MOD_LOG(VeryVerbose, TEXT("Processing handle at index %i. Handle: [%s]"), i, TEXT_STR(MakeHandle(i).ToString()))
 
-		MOD_LOG(VeryVerbose, TEXT("Processing handle at index %i. Handle: [%s]"), i, TEXT_STR(Handle.ToString()))
-
-		if (Handle.Buildable.IsValid()) // skip already available
+		if (auto* Buildable = PartBuildables[i].Get()) // skip already available
 		{
-			if (Handle.Buildable->GetIsLightweightTemporary())
+			if (Buildable->GetIsLightweightTemporary())
 			{
-				Handle.Buildable->SetBlockCleanupOfTemporary(true); // Block temporaries clean up during dismantle
+				Buildable->SetBlockCleanupOfTemporary(true); // Block temporaries clean up during dismantle
 			}
 
 			MOD_LOG(VeryVerbose, TEXT("  Buildable already available for handle."))
 			continue;
 		}
 
-		const auto* InstanceRef = LightweightRefsByHandle.Find(Handle);
-		fgcheck(InstanceRef);
-		fgcheck(InstanceRef->IsValid()); // we already removed invalid handles
+		const auto* InstanceRef = FindLightweightRefAt(i);
+		fgcheck(InstanceRef); // we already removed invalid handles
 
 		MOD_LOG(VeryVerbose, TEXT("  Ensuring temporary buildable spawned for lightweight handle"))
 		
@@ -150,39 +240,74 @@ void ABuildableAutoSupportProxy::EnsureBuildablesAvailable()
 		fgcheck(Temporary); // this should never be null.
 		Temporary->SetBlockCleanupOfTemporary(true);  // Block temporaries clean up during dismantle
 		
-		Handle.Buildable = Temporary;
+		PartBuildables[i] = Temporary;
 	}
 
 	bBuildablesAvailable = true;
 }
 
+void ABuildableAutoSupportProxy::ShowDismantleHighlight(AFGCharacterPlayer* Player)
+{
+	if (!EnsureLoadResolved())
+	{
+		return;
+	}
+
+	// Outline where the parts are. The lightweight instances themselves can't be outlined.
+	const auto ProxyTransform = GetActorTransform();
+	TArray<FAutoSupportPlannedPart> Parts;
+	Parts.Reserve(GetNumParts());
+
+	for (auto i = 0; i < GetNumParts(); ++i)
+	{
+		auto& Part = Parts.AddDefaulted_GetRef();
+		Part.BuildableClass = PartClasses[PartClassIndices[i]];
+		Part.RelativeTransform = GetPartRelativeTransform(i);
+	}
+
+	DismantleHighlightComponent->ShowParts(Parts, ProxyTransform);
+
+	if (auto* Outline = Player ? Player->GetOutline() : nullptr)
+	{
+		Outline->ShowOutline(this, EOutlineColor::OC_RED);
+	}
+}
+
+void ABuildableAutoSupportProxy::HideDismantleHighlight(AFGCharacterPlayer* Player)
+{
+	DismantleHighlightComponent->ClearPreview();
+
+	if (auto* Outline = Player ? Player->GetOutline() : nullptr)
+	{
+		Outline->HideOutline(this);
+	}
+}
+
 void ABuildableAutoSupportProxy::RemoveTemporaries(AFGCharacterPlayer* Player)
 {
-	if (bIsLoadTraceInProgress)
+	if (bIsLoadResolvePending)
 	{
-		MOD_LOG(Warning, TEXT("Invoked while load trace is in progress. No-op."))
+		MOD_LOG(Warning, TEXT("Invoked while load resolve is pending. No-op."))
 		return;
 	}
 	
-	MOD_LOG(Verbose, TEXT("Removing temporaries for up to %i buildables."), RegisteredHandles.Num())
+	MOD_LOG(Verbose, TEXT("Removing temporaries for up to %i buildables."), GetNumParts())
 	bBuildablesAvailable = false;
 	auto* Outline = Player ? Player->GetOutline() : nullptr;
 
 	RemoveInvalidHandles();
 	
-	for (auto i = 0; i < RegisteredHandles.Num(); ++i)
+	for (auto i = 0; i < GetNumParts(); ++i)
 	{
-		auto& Handle = RegisteredHandles[i];
-
-		MOD_LOG(VeryVerbose, TEXT("Processing handle at index %i. Handle: [%s]"), i, TEXT_STR(Handle.ToString()))
+		MOD_LOG(VeryVerbose, TEXT("Processing handle at index %i. Handle: [%s]"), i, TEXT_STR(MakeHandle(i).ToString()))
 
-		if (!Handle.Buildable.IsValid())
+		auto* Buildable = PartBuildables[i].Get();
+		
+		if (!Buildable)
 		{
 			MOD_LOG(Warning, TEXT("  Handle has invalid buildable. Skipping."))
 			continue;
 		}
-
-		auto* Buildable = Handle.Buildable.Get();
 	
 		if (Outline)
 		{
@@ -196,54 +321,77 @@ void ABuildableAutoSupportProxy::RemoveTemporaries(AFGCharacterPlayer* Player)
 			continue;
 		}
 
-		auto* Temporary = Handle.Buildable.Get();
-		Temporary->SetBlockCleanupOfTemporary(false);
+		Buildable->SetBlockCleanupOfTemporary(false);
 		
 		MOD_LOG(VeryVerbose, TEXT("  Handle had its temporary unblocked for cleanup."))
 		
-		Handle.Buildable = nullptr;
+		PartBuildables[i] = nullptr;
 	}
 }
 
 void ABuildableAutoSupportProxy::RemoveInvalidHandles()
 {
-	if (bIsLoadTraceInProgress)
+	if (bIsLoadResolvePending)
 	{
-		MOD_LOG(Warning, TEXT("RemoveInvalidHandles called while trace in progress. Skipping."))
+		MOD_LOG(Warning, TEXT("RemoveInvalidHandles called while load resolve is pending. Skipping."))
 		return;
 	}
 
-	MOD_LOG(Verbose, TEXT("Checking %i handles for validity and removing any invalid handles."), RegisteredHandles.Num())
+	MOD_LOG(Verbose, TEXT("Checking %i handles for validity and removing any invalid handles."), GetNumParts())
 	
-	if (RegisteredHandles.Num() == 0)
+	if (GetNumParts() == 0)
 	{
 		return;
 	}
-	
-	for (auto i = RegisteredHandles.Num() - 1; i >= 0; --i)
+
+	// A handle is invalid when its buildable is gone and it has no valid lightweight ref to spawn a temporary from.
+	const auto NumRemoved = RemovePartsWhere([this](const int32 PartIndex)
 	{
-		auto& Handle = RegisteredHandles[i];
+		return !PartBuildables[PartIndex].IsValid() && !FindLightweightRefAt(PartIndex);
+	});
 
-		if (Handle.Buildable.IsValid())
-		{
-			continue;
-		}
+	if (NumRemoved > 0)
+	{
+		MOD_LOG(Warning, TEXT("Removed %i invalid handles."), NumRemoved)
+	}
+}
 
-		const auto* LightweightRef = LightweightRefsByHandle.Find(Handle);
+bool ABuildableAutoSupportProxy::CompactHandles(TArray<FAutoSupportBuildableHandle>& OutDeadHandles, int32& OutNumDuplicates)
+{
+	OutNumDuplicates = 0;
+	
+	if (bIsLoadResolvePending || bIsInDismantleTransaction || bIsHoveredForDismantle || bBuildablesAvailable)
+	{
+		return false;
+	}
 
-		if (!LightweightRef)
+	TSet<FAutoSupportBuildableHandle> SeenHandles;
+	SeenHandles.Reserve(GetNumParts());
+
+	const auto ProxyTransform = GetActorTransform();
+	
+	RemovePartsWhere([&](const int32 PartIndex)
+	{
+		const auto Handle = MakeHandle(PartIndex, ProxyTransform);
+		
+		if (!Handle.Buildable.IsValid() && !FindLightweightRefAt(PartIndex))
 		{
-			MOD_LOG(Warning, TEXT("The handle at index %i is invalid. Buildable is not valid and no lightweight ref. Removing handle."), i)
-			RegisteredHandles.RemoveAt(i);
-			continue;
+			OutDeadHandles.Add(Handle);
+			return true;
 		}
 
-		if (!LightweightRef->IsValid())
+		// Equal within tolerance means the same lightweight instance or actor.
+		if (FAutoSupportBuildableHandle Match; Handle.FindInWithTolerance(SeenHandles, Match))
 		{
-			MOD_LOG(Warning, TEXT("The handle at index [%i] is invalid. Lightweight ref was found but it's not valid. Removing handle."), i)
-			RegisteredHandles.RemoveAt(i);
+			++OutNumDuplicates;
+			return true;
 		}
-	}
+
+		SeenHandles.Add(Handle);
+		return false;
+	});
+
+	return true;
 }
 
 bool ABuildableAutoSupportProxy::DestroyIfEmpty(bool bRemoveInvalidHandles)
@@ -253,7 +401,7 @@ bool ABuildableAutoSupportProxy::DestroyIfEmpty(bool bRemoveInvalidHandles)
 		RemoveInvalidHandles();
 	}
 	
-	if (RegisteredHandles.Num() != 0)
+	if (GetNumParts() != 0)
 	{
 		return false;
 	}
@@ -270,120 +418,262 @@ bool ABuildableAutoSupportProxy::DestroyIfEmpty(bool bRemoveInvalidHandles)
 
 void ABuildableAutoSupportProxy::RegisterSelfAndHandlesWithSubsystem()
 {
-	MOD_LOG(Verbose, TEXT("Registering self and %i handles with subsystem."), RegisteredHandles.Num())
+	MOD_LOG(Verbose, TEXT("Registering self and %i handles with subsystem."), GetNumParts())
 	
 	auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld());
 	SupportSubsys->RegisterProxy(this);
 
-	for (const auto& Handle : RegisteredHandles)
+	const auto ProxyTransform = GetActorTransform();
+	
+	for (auto i = 0; i < GetNumParts(); ++i)
 	{
 		// It's transient to the subsys
-		SupportSubsys->RegisterHandleToProxyLink(Handle, this);
+		SupportSubsys->RegisterHandleToProxyLink(MakeHandle(i, ProxyTransform), this);
 	}
 }
 
-void ABuildableAutoSupportProxy::BeginLoadTrace()
+bool ABuildableAutoSupportProxy::EnsureLoadResolved()
 {
-	// Need to reestablish lightweight runtime indices, so trace and match by buildable class and transform.
-	FCollisionObjectQueryParams ObjectQueryParams(FCollisionObjectQueryParams::AllObjects);
-		
-	FCollisionQueryParams TraceParams;
-	TraceParams.AddIgnoredActor(this);
+	if (bIsLoadResolvePending)
+	{
+		MOD_LOG(Verbose, TEXT("Interacted with before its load resolve, resolving now."))
+		AAutoSupportModSubsystem::Get(GetWorld())->ResolveLightweightsNow(this);
+	}
 
-	const auto TraceLocation = BoundingBoxComponent->GetComponentLocation();
-	const auto TraceRotation = BoundingBoxComponent->GetComponentRotation();
-	const FCollisionShape CollisionShape = BoundingBoxComponent->GetCollisionShape();
-		
-	// Overlap all so we can detect all collisions in our path.
-	// FCollisionResponseParams ResponseParams(ECR_Overlap);
-
-	LoadTraceDelegate.BindUObject(this, &ABuildableAutoSupportProxy::OnLoadTraceComplete);
-	bIsLoadTraceInProgress = true;
-
-	MOD_TRACE_LOG(
-		Verbose,
-		TEXT("Beginning load trace. TraceLocation: [%s], TraceRotation: [%s], TraceExtent: [%s]"),
-		TEXT_STR(TraceLocation.ToCompactString()),
-		TEXT_STR(TraceRotation.ToCompactString()),
-		TEXT_STR(CollisionShape.GetExtent().ToCompactString()))
-		
-	GetWorld()->AsyncOverlapByObjectType(
-		TraceLocation,
-		BoundingBoxComponent->GetComponentRotation().Quaternion(),
-		ObjectQueryParams,
-		CollisionShape,
-		TraceParams,
-		&LoadTraceDelegate);
+	return IsValid(this);
+}
+
+const FLightweightBuildableInstanceRef* ABuildableAutoSupportProxy::FindLightweightRef(const FAutoSupportBuildableHandle& Handle) const
+{
+	return FindLightweightRefAt(FindPartIndex(Handle));
 }
 
-void ABuildableAutoSupportProxy::OnLoadTraceComplete(const FTraceHandle& Handle, FOverlapDatum& Datum)
+void ABuildableAutoSupportProxy::RepairLightweightRef(const FAutoSupportBuildableHandle& Handle, const FLightweightBuildableInstanceRef& InstanceRef)
 {
-	bIsLoadTraceInProgress = false;
+	const auto PartIndex = FindPartIndex(Handle);
+	if (PartIndex == INDEX_NONE)
+	{
+		MOD_LOG(Warning, TEXT("Cannot repair lightweight ref, handle is not registered: [%s]"), TEXT_STR(Handle.ToString()))
+		return;
+	}
+
+	MOD_LOG(Verbose, TEXT("Repaired lightweight ref for handle: [%s]"), TEXT_STR(Handle.ToString()))
+	LightweightRefs[PartIndex] = InstanceRef;
+}
+
+void ABuildableAutoSupportProxy::GetHandleMemoryUsage(SIZE_T& OutBytes, SIZE_T& OutHandleBytes, SIZE_T& OutSavedBytes) const
+{
+	OutBytes = PartClasses.GetAllocatedSize()
+		+ PartOrientations.GetAllocatedSize()
+		+ PartClassIndices.GetAllocatedSize()
+		+ PartOrientationIndices.GetAllocatedSize()
+		+ PartOffsets.GetAllocatedSize()
+		+ PartBuildables.GetAllocatedSize()
+		+ LightweightRefs.GetAllocatedSize();
+
+	// Rebuilds the way the parts used to be held, so the report measures actual allocations rather than an estimate.
+	TArray<FAutoSupportBuildableHandle> Handles;
+	Handles.Reserve(GetNumParts());
+	AppendHandles(Handles);
 	
-	// TODO(k.a): should this block also be done async? If so, need to register with subsystem in synchronized matter.
-	MOD_TRACE_LOG(
-		Verbose,
-		TEXT("Load trace completed. TraceLocation: [%s], TraceRotation: [%s], TraceExtent: [%s], Num Overlaps: [%i]"),
-		TEXT_STR(BoundingBoxComponent->GetComponentLocation().ToCompactString()),
-		TEXT_STR(BoundingBoxComponent->GetComponentRotation().ToCompactString()),
-		TEXT_STR(BoundingBoxComponent->GetCollisionShape().GetExtent().ToCompactString()),
-		Datum.OutOverlaps.Num())
+	TMap<FAutoSupportBuildableHandle, FLightweightBuildableInstanceRef> KeyedRefs;
+	for (auto i = 0; i < Handles.Num(); ++i)
+	{
+		if (const auto* InstanceRef = FindLightweightRefAt(i))
+		{
+			KeyedRefs.Add(Handles[i], *InstanceRef);
+		}
+	}
+
+	OutHandleBytes = Handles.GetAllocatedSize() + KeyedRefs.GetAllocatedSize();
+
+	TArray<TSubclassOf<AFGBuildable>> EncodedClasses;
+	TArray<TWeakObjectPtr<AFGBuildable>> EncodedBuildables;
+	TArray<uint8> EncodedData;
+	FAutoSupportHandleCodec::Encode(Handles, GetActorTransform(), EncodedClasses, EncodedBuildables, EncodedData);
+
+	OutSavedBytes = EncodedClasses.GetAllocatedSize() + EncodedBuildables.GetAllocatedSize() + EncodedData.GetAllocatedSize();
+}
+
+FAutoSupportBuildableHandle ABuildableAutoSupportProxy::MakeHandle(const int32 PartIndex) const
+{
+	return MakeHandle(PartIndex, GetActorTransform());
+}
+
+FAutoSupportBuildableHandle ABuildableAutoSupportProxy::MakeHandle(const int32 PartIndex, const FTransform& ProxyTransform) const
+{
+	FAutoSupportBuildableHandle Handle(PartClasses[PartClassIndices[PartIndex]], GetPartRelativeTransform(PartIndex) * ProxyTransform);
+	Handle.Buildable = PartBuildables[PartIndex];
+	
+	return Handle;
+}
+
+void ABuildableAutoSupportProxy::AppendHandles(TArray<FAutoSupportBuildableHandle>& OutHandles) const
+{
+	const auto ProxyTransform = GetActorTransform();
+	
+	for (auto i = 0; i < GetNumParts(); ++i)
+	{
+		OutHandles.Add(MakeHandle(i, ProxyTransform));
+	}
+}
+
+int32 ABuildableAutoSupportProxy::FindPartIndex(const FAutoSupportBuildableHandle& Handle) const
+{
+	const auto ClassIndex = PartClasses.IndexOfByKey(Handle.GetBuildableClass());
+	if (ClassIndex == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
 
-	if (Datum.OutOverlaps.Num() < RegisteredHandles.Num())
+	const auto ProxyTransform = GetActorTransform();
+	
+	for (auto i = 0; i < GetNumParts(); ++i)
 	{
-		MOD_TRACE_LOG(Error, TEXT("Load trace returned less overlaps than registered handles. Expected at least: [%i], Actual: [%i]"), RegisteredHandles.Num(), Datum.OutOverlaps.Num())
+		// The class index is compared first so only parts of the class are made into handles.
+		if (PartClassIndices[i] == ClassIndex && MakeHandle(i, ProxyTransform) == Handle)
+		{
+			return i;
+		}
 	}
+
+	return INDEX_NONE;
+}
+
+FTransform ABuildableAutoSupportProxy::GetPartRelativeTransform(const int32 PartIndex) const
+{
+	const auto& Orientation = PartOrientations[PartOrientationIndices[PartIndex]];
 	
-	TMap<FAutoSupportBuildableHandle, FLightweightBuildableInstanceRef> OverlapRefsByHandle;
+	return FTransform(
+		FQuat(Orientation.Rotation),
+		FAutoSupportHandleCodec::DequantizeOffset(PartOffsets[PartIndex]),
+		FVector(Orientation.Scale));
+}
 
-#ifdef AUTOSUPPORT_DEV_LOGGING
-	for (const auto& PersistedHandle : RegisteredHandles)
+int32 ABuildableAutoSupportProxy::AddPart(
+	const TSubclassOf<AFGBuildable> BuildableClass,
+	const FTransform& Transform,
+	const TWeakObjectPtr<AFGBuildable>& Buildable)
+{
+	const auto RelativeTransform = Transform.GetRelativeTransform(GetActorTransform());
+	const FAutoSupportProxyPartOrientation PartOrientation
 	{
-		MOD_TRACE_LOG(VeryVerbose, TEXT("  PersistedHandle: [%s]"), TEXT_STR(PersistedHandle.ToString()))
+		FQuat4f(RelativeTransform.GetRotation()),
+		FVector3f(RelativeTransform.GetScale3D())
+	};
+
+	// The tables are indexed by uint16.
+	auto ClassIndex = PartClasses.IndexOfByKey(BuildableClass);
+	if (ClassIndex == INDEX_NONE && PartClasses.Num() <= MAX_uint16)
+	{
+		ClassIndex = PartClasses.Add(BuildableClass);
 	}
-#endif
 
-	// Collect refs of overlaps and assign a handle key to them.
-	for (const auto& OverlapResult : Datum.OutOverlaps)
+	auto OrientationIndex = PartOrientations.IndexOfByPredicate([&PartOrientation](const FAutoSupportProxyPartOrientation& Orientation)
 	{
-		auto* HitActor = OverlapResult.GetActor();
-		
-		MOD_TRACE_LOG(VeryVerbose, TEXT("Overlapped Actor: [%s]"), TEXT_ACTOR_NAME(HitActor))
-		
-		if (auto* AbstractInstManager = Cast<AAbstractInstanceManager>(HitActor))
+		return Orientation.Rotation.Equals(PartOrientation.Rotation, UE_KINDA_SMALL_NUMBER)
+			&& Orientation.Scale.Equals(PartOrientation.Scale, UE_KINDA_SMALL_NUMBER);
+	});
+	
+	if (OrientationIndex == INDEX_NONE && PartOrientations.Num() <= MAX_uint16)
+	{
+		OrientationIndex = PartOrientations.Add(PartOrientation);
+	}
+
+	if (ClassIndex == INDEX_NONE || OrientationIndex == INDEX_NONE)
+	{
+		MOD_LOG(Error, TEXT("Part tables are full, not registering part of class [%s]."), TEXT_CLS_NAME(BuildableClass))
+		return INDEX_NONE;
+	}
+
+	PartClassIndices.Add(static_cast<uint16>(ClassIndex));
+	PartOrientationIndices.Add(static_cast<uint16>(OrientationIndex));
+	PartOffsets.Add(FAutoSupportHandleCodec::QuantizeOffset(RelativeTransform.GetLocation()));
+	PartBuildables.Add(Buildable);
+	LightweightRefs.AddDefaulted();
+
+	return PartClassIndices.Num() - 1;
+}
+
+void ABuildableAutoSupportProxy::SetParts(const TArray<FAutoSupportBuildableHandle>& NewHandles)
+{
+	PartClasses.Reset();
+	PartOrientations.Reset();
+	PartClassIndices.Reset(NewHandles.Num());
+	PartOrientationIndices.Reset(NewHandles.Num());
+	PartOffsets.Reset(NewHandles.Num());
+	PartBuildables.Reset(NewHandles.Num());
+	LightweightRefs.Reset(NewHandles.Num());
+
+	for (const auto& Handle : NewHandles)
+	{
+		AddPart(Handle.GetBuildableClass(), Handle.GetTransform(), Handle.Buildable);
+	}
+}
+
+const FLightweightBuildableInstanceRef* ABuildableAutoSupportProxy::FindLightweightRefAt(const int32 PartIndex) const
+{
+	return LightweightRefs.IsValidIndex(PartIndex) && LightweightRefs[PartIndex].IsValid() ? &LightweightRefs[PartIndex] : nullptr;
+}
+
+int32 ABuildableAutoSupportProxy::RemovePartsWhere(TFunctionRef<bool(int32 PartIndex)> Predicate)
+{
+	// Not a swap removal, the root part has to stay first. The tables keep their entries, they are per proxy and small.
+	auto NumKept = 0;
+	for (auto i = 0; i < GetNumParts(); ++i)
+	{
+		if (Predicate(i))
 		{
-			if (FInstanceHandle InstanceHandle; AbstractInstManager->ResolveOverlap(OverlapResult, InstanceHandle))
-			{
-				if (FLightweightBuildableInstanceRef LightweightInstRef; AFGLightweightBuildableSubsystem::ResolveLightweightInstance(InstanceHandle, LightweightInstRef))
-				{
-					FAutoSupportBuildableHandle OverlapHandle(LightweightInstRef);
-					
-					MOD_TRACE_LOG(VeryVerbose, TEXT("  OverlapHandle: [%s]"), TEXT_STR(OverlapHandle.ToString()))
-					
-					OverlapRefsByHandle.Add(OverlapHandle, LightweightInstRef);
-				}
-				else
-				{
-					MOD_TRACE_LOG(Warning, TEXT("Failed to resolve overlap to lightweight instance ref."))
-				}
-			}
-			else
-			{
-				MOD_TRACE_LOG(Warning, TEXT("Failed to resolve overlap to instance handle."))
-			}
+			continue;
 		}
-		else if (auto* Buildable = Cast<AFGBuildable>(HitActor); Buildable && Buildable->ShouldConvertToLightweight())
+
+		if (NumKept != i)
 		{
-			MOD_TRACE_LOG(Error, TEXT("Hit a buildable instance that should be converted to lightweight. I don't think we're expecting this at load time?"))
+			PartClassIndices[NumKept] = PartClassIndices[i];
+			PartOrientationIndices[NumKept] = PartOrientationIndices[i];
+			PartOffsets[NumKept] = PartOffsets[i];
+			PartBuildables[NumKept] = PartBuildables[i];
+			LightweightRefs[NumKept] = LightweightRefs[i];
 		}
+		
+		++NumKept;
+	}
+
+	const auto NumRemoved = GetNumParts() - NumKept;
+	PartClassIndices.SetNum(NumKept);
+	PartOrientationIndices.SetNum(NumKept);
+	PartOffsets.SetNum(NumKept);
+	PartBuildables.SetNum(NumKept);
+	LightweightRefs.SetNum(NumKept);
+	
+	return NumRemoved;
+}
+
+void ABuildableAutoSupportProxy::ResolveLightweightRefs(const TMap<FAutoSupportBuildableHandle, FLightweightBuildableInstanceRef>& RefsByHandle)
+{
+	bIsLoadResolvePending = false;
+
+	const auto ProxyTransform = GetActorTransform();
+	
+#ifdef AUTOSUPPORT_DEV_LOGGING
+	for (auto i = 0; i < GetNumParts(); ++i)
+	{
+		MOD_TRACE_LOG(VeryVerbose, TEXT("  PersistedHandle: [%s]"), TEXT_STR(MakeHandle(i, ProxyTransform).ToString()))
 	}
+#endif
 
 	// Store the transient ref for the handle
-	for (const auto& RegisteredHandle : RegisteredHandles)
+	for (auto i = 0; i < GetNumParts(); ++i)
 	{
-		if (auto* InstanceRef = OverlapRefsByHandle.Find(RegisteredHandle); InstanceRef)
+		const auto RegisteredHandle = MakeHandle(i, ProxyTransform);
+		if (!RegisteredHandle.IsConsideredLightweight())
+		{
+			continue;
+		}
+		
+		if (const auto* InstanceRef = RefsByHandle.Find(RegisteredHandle); InstanceRef)
 		{
-			LightweightRefsByHandle.Add(RegisteredHandle, *InstanceRef);
+			LightweightRefs[i] = *InstanceRef;
 			MOD_TRACE_LOG(VeryVerbose, TEXT("Registered transient ref for handle: [%s]"), TEXT_STR(RegisteredHandle.ToString()))
 		}
 		else
@@ -414,14 +704,20 @@ void ABuildableAutoSupportProxy::StartIsLookedAtForDismantle_Implementation(AFGC
 {
 	MOD_LOG(Verbose, TEXT("Invoked"))
 	bIsHoveredForDismantle = true;
-	EnsureBuildablesAvailable();
+	ShowDismantleHighlight(byCharacter);
 }
 
 void ABuildableAutoSupportProxy::StopIsLookedAtForDismantle_Implementation(AFGCharacterPlayer* byCharacter)
 {
 	MOD_LOG(Verbose, TEXT("Invoked"))
 	bIsHoveredForDismantle = false;
-	RemoveTemporaries(byCharacter);
+	HideDismantleHighlight(byCharacter);
+
+	// Only spawned if a dismantle did not go through.
+	if (bBuildablesAvailable)
+	{
+		RemoveTemporaries(byCharacter);
+	}
 }
 
 void ABuildableAutoSupportProxy::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -439,28 +735,39 @@ void ABuildableAutoSupportProxy::EndPlay(const EEndPlayReason::Type EndPlayReaso
 void ABuildableAutoSupportProxy::Dismantle_Implementation()
 {
 	MOD_LOG(Verbose, TEXT("Dismantle called. Buildables available: [%s], IsHoveredForDismantle: [%s]"), TEXT_BOOL(bBuildablesAvailable), TEXT_BOOL(bIsHoveredForDismantle))
-	MOD_LOG(Verbose, TEXT("Dismantling %i buildables..."), RegisteredHandles.Num())
-	EnsureBuildablesAvailable();
+	MOD_LOG(Verbose, TEXT("Dismantling %i buildables..."), GetNumParts())
 
-	Destroy();
-}
+	if (!EnsureLoadResolved())
+	{
+		return;
+	}
+	
+	// The parts are dismantled here rather than as child dismantle actors, so they only become actors now.
+	EnsureBuildablesAvailable();
 
-void ABuildableAutoSupportProxy::GetChildDismantleActors_Implementation(TArray<AActor*>& out_ChildDismantleActors) const
-{
-	MOD_LOG(Verbose, TEXT("BuildablesAvailable: [%s], HoveredForDismantle: [%s]"), TEXT_BOOL(bBuildablesAvailable), TEXT_BOOL(bIsHoveredForDismantle))
+	// Collect first, dismantling a part unregisters its handle.
+	TArray<AFGBuildable*> Parts;
+	Parts.Reserve(GetNumParts());
 	
-	if (!bBuildablesAvailable)
+	for (const auto& PartBuildable : PartBuildables)
 	{
-		MOD_LOG(Warning, TEXT("Invoked but BuildablesAvailable is FALSE."))
-		return;
+		if (PartBuildable.IsValid())
+		{
+			Parts.Add(PartBuildable.Get());
+		}
 	}
 
-	for (auto& Handle : RegisteredHandles)
+	for (auto* Part : Parts)
 	{
-		out_ChildDismantleActors.Add(Handle.Buildable.Get());
+		Execute_Dismantle(Part);
 	}
 
-	MOD_LOG(Verbose, TEXT("Dismantle child actors, Count: [%i]"), out_ChildDismantleActors.Num())
+	Destroy();
+}
+
+void ABuildableAutoSupportProxy::GetChildDismantleActors_Implementation(TArray<AActor*>& out_ChildDismantleActors) const
+{
+	// None. The parts are refunded from their handles and dismantled by Dismantle, so they don't need to be actors to be selected.
 }
 
 void ABuildableAutoSupportProxy::GetDismantleDependencies_Implementation(TArray<AActor*>& out_dismantleDependencies) const
@@ -472,18 +779,42 @@ void ABuildableAutoSupportProxy::GetDismantleDisqualifiers_Implementation(
 	TArray<TSubclassOf<UFGConstructDisqualifier>>& out_dismantleDisqualifiers,
 	const TArray<AActor*>& allSelectedActors) const
 {
+	// The blueprint would refund the parts too.
+	if (BlueprintProxy.IsValid() && allSelectedActors.Contains(BlueprintProxy.Get()))
+	{
+		out_dismantleDisqualifiers.AddUnique(UAutoSupportConstructDisqualifier_OwnedBySelectedBlueprint::StaticClass());
+	}
 }
 
 void ABuildableAutoSupportProxy::GetDismantleRefund_Implementation(TArray<FInventoryStack>& out_refund, bool noBuildCostEnabled) const
 {
-	// NOTE: This is for this actor only. The refunds from registered buildables are propagated via get GetChildDismantleActors.
+	if (noBuildCostEnabled)
+	{
+		return;
+	}
+
+	// Computed from the handles so the refund shows without spawning the lightweight parts.
+	if (auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld()))
+	{
+		TArray<FAutoSupportBuildableHandle> Handles;
+		Handles.Reserve(GetNumParts());
+		AppendHandles(Handles);
+		
+		SupportSubsys->GetHandlesRefund(Handles, out_refund);
+	}
 }
 
 FVector ABuildableAutoSupportProxy::GetRefundSpawnLocationAndArea_Implementation(const FVector& aimHitLocation, float& out_radius) const
 {
-	const auto* RootBuildable = GetCheckedRootBuildable();
+	// The root may be gone already when dismantled along with a blueprint, so fall back to our own bounds.
+	if (auto* RootBuildable = GetRootBuildable())
+	{
+		return Execute_GetRefundSpawnLocationAndArea(RootBuildable, aimHitLocation, out_radius);
+	}
 
-	return Execute_GetRefundSpawnLocationAndArea(RootBuildable, aimHitLocation, out_radius);
+	out_radius = BoundingBox.GetExtent().Size2D();
+	
+	return GetActorTransform().TransformPosition(BoundingBox.GetCenter());
 }
 
 void ABuildableAutoSupportProxy::PreUpgrade_Implementation()
@@ -520,10 +851,22 @@ bool ABuildableAutoSupportProxy::NeedTransform_Implementation()
 
 void ABuildableAutoSupportProxy::PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
 {
+	TArray<FAutoSupportBuildableHandle> Handles;
+	Handles.Reserve(GetNumParts());
+	AppendHandles(Handles);
+	
+	FAutoSupportHandleCodec::Encode(Handles, GetActorTransform(), SavedHandleClasses, SavedHandleBuildables, SavedHandleData);
+	RegisteredHandles.Empty();
+
+	MOD_LOG(VeryVerbose, TEXT("Encoded %i handles into %i bytes."), Handles.Num(), SavedHandleData.Num())
 }
 
 void ABuildableAutoSupportProxy::PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
 {
+	// The encoded handles are only needed while saving.
+	SavedHandleClasses.Empty();
+	SavedHandleBuildables.Empty();
+	SavedHandleData.Empty();
 }
 
 void ABuildableAutoSupportProxy::PreLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
@@ -532,6 +875,27 @@ void ABuildableAutoSupportProxy::PreLoadGame_Implementation(int32 saveVersion, i
 
 void ABuildableAutoSupportProxy::PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
 {
+	if (!RegisteredHandles.IsEmpty())
+	{
+		// Saved before the compact encoding, the parts are laid out from the legacy handles.
+		MOD_LOG(Verbose, TEXT("Migrating %i legacy handles."), RegisteredHandles.Num())
+		
+		SetParts(RegisteredHandles);
+		RegisteredHandles.Empty();
+	}
+	else if (TArray<FAutoSupportBuildableHandle> Handles; FAutoSupportHandleCodec::Decode(SavedHandleData, GetActorTransform(), SavedHandleClasses, SavedHandleBuildables, Handles))
+	{
+		SetParts(Handles);
+	}
+	else
+	{
+		MOD_LOG(Error, TEXT("Failed to decode the saved handles."))
+	}
+
+	SavedHandleClasses.Empty();
+	SavedHandleBuildables.Empty();
+	SavedHandleData.Empty();
+	
 	BoundingBoxComponent->SetRelativeLocation(BoundingBox.GetCenter());
 	BoundingBoxComponent->SetBoxExtent(BoundingBox.GetExtent());
 }
@@ -0,0 +1,96 @@
+﻿//
+
+#include "BuildableAutoSupportProxyCollision.h"
+
+#include "BuildableAutoSupportProxy.h"
+#include "ModLogging.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+ABuildableAutoSupportProxyCollision::ABuildableAutoSupportProxyCollision()
+{
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
+	RootComponent->SetMobility(EComponentMobility::Type::Movable);
+
+	InstanceCollisionComponent = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("InstanceCollisionComponent"));
+	InstanceCollisionComponent->SetMobility(EComponentMobility::Type::Movable);
+	InstanceCollisionComponent->SetupAttachment(RootComponent);
+	InstanceCollisionComponent->SetHiddenInGame(true);
+	InstanceCollisionComponent->SetCastShadow(false);
+	InstanceCollisionComponent->SetCanEverAffectNavigation(false);
+	InstanceCollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	InstanceCollisionComponent->bSupportRemoveAtSwap = true; // Proxies are removed by swap too, keeping the instance index in sync.
+
+	SetCanBeDamaged(false);
+}
+
+void ABuildableAutoSupportProxyCollision::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (CollisionMesh)
+	{
+		InstanceCollisionComponent->SetStaticMesh(CollisionMesh);
+	}
+}
+
+void ABuildableAutoSupportProxyCollision::AddOrUpdateProxy(ABuildableAutoSupportProxy* Proxy)
+{
+	fgcheck(Proxy);
+
+	const auto InstanceTransform = GetInstanceTransform(Proxy);
+
+	if (const auto* InstanceIndex = InstanceByProxy.Find(Proxy))
+	{
+		InstanceCollisionComponent->UpdateInstanceTransform(*InstanceIndex, InstanceTransform, false, true);
+		return;
+	}
+
+	InstanceByProxy.Add(Proxy, InstanceProxies.Add(Proxy));
+	InstanceCollisionComponent->AddInstance(InstanceTransform);
+}
+
+void ABuildableAutoSupportProxyCollision::RemoveProxy(const ABuildableAutoSupportProxy* Proxy)
+{
+	int32 InstanceIndex;
+	if (!InstanceByProxy.RemoveAndCopyValue(Proxy, InstanceIndex))
+	{
+		return;
+	}
+
+	// Swap removal on both, so the last proxy and instance move into the removed slot.
+	InstanceProxies.RemoveAtSwap(InstanceIndex);
+	InstanceCollisionComponent->RemoveInstance(InstanceIndex);
+
+	if (InstanceProxies.IsValidIndex(InstanceIndex))
+	{
+		InstanceByProxy.Add(InstanceProxies[InstanceIndex], InstanceIndex);
+	}
+}
+
+ABuildableAutoSupportProxy* ABuildableAutoSupportProxyCollision::FindProxyByInstance(const int32 InstanceIndex) const
+{
+	return InstanceProxies.IsValidIndex(InstanceIndex) ? InstanceProxies[InstanceIndex].Get() : nullptr;
+}
+
+void ABuildableAutoSupportProxyCollision::SetCollisionActive(const bool bActive)
+{
+	if (bActive && !DismantleCollisionProfileName.IsNone())
+	{
+		InstanceCollisionComponent->SetCollisionProfileName(DismantleCollisionProfileName);
+	}
+
+	InstanceCollisionComponent->SetCollisionEnabled(bActive ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
+}
+
+FTransform ABuildableAutoSupportProxyCollision::GetInstanceTransform(const ABuildableAutoSupportProxy* Proxy) const
+{
+	// A box over the proxy bounds, oriented like the proxy.
+	const auto& LocalBounds = Proxy->GetLocalBounds();
+	const auto& ProxyTransform = Proxy->GetActorTransform();
+	const FTransform WorldTransform(
+		ProxyTransform.GetRotation(),
+		ProxyTransform.TransformPosition(LocalBounds.GetCenter()),
+		LocalBounds.GetExtent() / CollisionMeshExtent);
+
+	return WorldTransform.GetRelativeTransform(GetActorTransform());
+}
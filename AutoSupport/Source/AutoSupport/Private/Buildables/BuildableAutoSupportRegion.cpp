@@ -0,0 +1,515 @@
+﻿//
+
+#include "BuildableAutoSupportRegion.h"
+
+#include "AutoSupportBuildGunExtensionsModule.h"
+#include "AutoSupportModSubsystem.h"
+#include "BuildableAutoSupportPreviewComponent.h"
+#include "FGBuildable.h"
+#include "FGCharacterPlayer.h"
+#include "FGInventoryComponent.h"
+#include "ModDefines.h"
+#include "ModLogging.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+ABuildableAutoSupportRegion::ABuildableAutoSupportRegion()
+{
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
+	RootComponent->SetMobility(EComponentMobility::Type::Movable);
+
+	RecordCollisionComponent = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("RecordCollisionComponent"));
+	RecordCollisionComponent->SetMobility(EComponentMobility::Type::Movable);
+	RecordCollisionComponent->SetupAttachment(RootComponent);
+	RecordCollisionComponent->SetHiddenInGame(true);
+	RecordCollisionComponent->SetCastShadow(false);
+	RecordCollisionComponent->SetCanEverAffectNavigation(false);
+	RecordCollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	RecordCollisionComponent->bSupportRemoveAtSwap = true; // Records are removed by swap too, keeping instance index == record index.
+}
+
+FIntVector ABuildableAutoSupportRegion::GetRegionCell(const FVector& Location)
+{
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / AUTOSUPPORT_REGION_CELL_SIZE),
+		FMath::FloorToInt32(Location.Y / AUTOSUPPORT_REGION_CELL_SIZE),
+		FMath::FloorToInt32(Location.Z / AUTOSUPPORT_REGION_CELL_SIZE));
+}
+
+FVector ABuildableAutoSupportRegion::GetRegionCellCenter(const FIntVector& Cell)
+{
+	return (FVector(Cell) + FVector(0.5)) * AUTOSUPPORT_REGION_CELL_SIZE;
+}
+
+void ABuildableAutoSupportRegion::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (RecordCollisionMesh)
+	{
+		RecordCollisionComponent->SetStaticMesh(RecordCollisionMesh);
+	}
+
+	RebuildRecordIndex();
+	RebuildCollisionInstances();
+
+	AAutoSupportModSubsystem::Get(GetWorld())->RegisterRegion(this);
+}
+
+void ABuildableAutoSupportRegion::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		AAutoSupportModSubsystem::Get(GetWorld())->OnRegionDestroyed(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 ABuildableAutoSupportRegion::AddRecord(const FTransform& SupportTransform, const FBox& LocalBounds, const TArray<AFGBuildable*>& Buildables)
+{
+	auto& Record = Records.AddDefaulted_GetRef();
+	Record.RecordId = NextRecordId++;
+	Record.Transform = SupportTransform;
+	Record.LocalBounds = LocalBounds;
+	Record.Handles.Reserve(Buildables.Num());
+
+	for (auto* Buildable : Buildables)
+	{
+		Record.Handles.Emplace(Buildable);
+	}
+
+	RecordIndexById.Add(Record.RecordId, Records.Num() - 1);
+	RecordCollisionComponent->AddInstance(GetCollisionInstanceTransform(Record));
+
+	if (HasActorBegunPlay())
+	{
+		AAutoSupportModSubsystem::Get(GetWorld())->LinkRegionRecord(this, Record);
+	}
+
+	MOD_LOG(Verbose, TEXT("Added record %i with %i handles. Records: %i"), Record.RecordId, Record.Handles.Num(), Records.Num())
+
+	return Record.RecordId;
+}
+
+void ABuildableAutoSupportRegion::RemoveRecord(const int32 RecordId)
+{
+	if (const auto* RecordIndex = RecordIndexById.Find(RecordId))
+	{
+		RemoveRecordAt(*RecordIndex);
+	}
+}
+
+void ABuildableAutoSupportRegion::UnregisterRecordHandle(const int32 RecordId, const FAutoSupportBuildableHandle& Handle)
+{
+	const auto* RecordIndex = RecordIndexById.Find(RecordId);
+	if (!RecordIndex)
+	{
+		return;
+	}
+
+	auto& Record = Records[*RecordIndex];
+	Record.Handles.RemoveSingleSwap(Handle);
+
+	if (Record.Handles.IsEmpty())
+	{
+		RemoveRecordAt(*RecordIndex);
+	}
+}
+
+void ABuildableAutoSupportRegion::RemoveRecordAt(const int32 RecordIndex)
+{
+	fgcheck(Records.IsValidIndex(RecordIndex));
+
+	const auto RecordId = Records[RecordIndex].RecordId;
+
+	AAutoSupportModSubsystem::Get(GetWorld())->UnlinkRegionHandles(Records[RecordIndex].Handles);
+
+	// Swap removal on both, so the last record and instance move into the removed slot.
+	Records.RemoveAtSwap(RecordIndex);
+	RecordCollisionComponent->RemoveInstance(RecordIndex);
+	RecordIndexById.Remove(RecordId);
+
+	if (Records.IsValidIndex(RecordIndex))
+	{
+		RecordIndexById.Add(Records[RecordIndex].RecordId, RecordIndex);
+	}
+
+	// Only the highlights of the players aiming at the removed record are cleared.
+	TArray<AFGCharacterPlayer*> AimingPlayers;
+	
+	for (auto It = AimedRecordByPlayer.CreateIterator(); It; ++It)
+	{
+		if (It->Value == RecordId)
+		{
+			AimingPlayers.Add(It->Key.Get());
+			It.RemoveCurrent();
+		}
+	}
+
+	for (auto* Player : AimingPlayers)
+	{
+		ShowAimedRecordHighlight(Player);
+	}
+
+	MOD_LOG(Verbose, TEXT("Removed record %i. Records: %i"), RecordId, Records.Num())
+
+	if (Records.IsEmpty())
+	{
+		Destroy();
+	}
+}
+
+const FAutoSupportRegionRecord* ABuildableAutoSupportRegion::FindRecord(const int32 RecordId) const
+{
+	const auto* RecordIndex = RecordIndexById.Find(RecordId);
+	return RecordIndex ? &Records[*RecordIndex] : nullptr;
+}
+
+const FAutoSupportRegionRecord* ABuildableAutoSupportRegion::FindRecordByCollisionInstance(const int32 InstanceIndex) const
+{
+	return Records.IsValidIndex(InstanceIndex) ? &Records[InstanceIndex] : nullptr;
+}
+
+int32 ABuildableAutoSupportRegion::TraceRecord(const FVector& Start, const FVector& End) const
+{
+	auto HitRecordId = INDEX_NONE;
+	auto NearestHitDistanceSquared = TNumericLimits<double>::Max();
+
+	for (const auto& Record : Records)
+	{
+		// In the record's space its bounds are axis aligned.
+		const auto LocalStart = Record.Transform.InverseTransformPosition(Start);
+		const auto LocalEnd = Record.Transform.InverseTransformPosition(End);
+
+		FVector HitLocation;
+		FVector HitNormal;
+		float HitTime;
+		
+		if (!FMath::LineExtentBoxIntersection(Record.LocalBounds, LocalStart, LocalEnd, FVector::ZeroVector, HitLocation, HitNormal, HitTime))
+		{
+			continue;
+		}
+
+		if (const auto DistanceSquared = FVector::DistSquared(Start, Record.Transform.TransformPosition(HitLocation)); DistanceSquared < NearestHitDistanceSquared)
+		{
+			NearestHitDistanceSquared = DistanceSquared;
+			HitRecordId = Record.RecordId;
+		}
+	}
+
+	return HitRecordId;
+}
+
+void ABuildableAutoSupportRegion::SetAimedRecord(const int32 RecordId, AFGCharacterPlayer* Player)
+{
+	// A listen server ticks the build guns of remote players too. Their aims are theirs to show, not the host's.
+	if (!Player || !Player->IsLocallyControlled())
+	{
+		return;
+	}
+
+	if (const auto* AimedRecordId = AimedRecordByPlayer.Find(Player); AimedRecordId ? *AimedRecordId == RecordId : RecordId == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (RecordId == INDEX_NONE)
+	{
+		AimedRecordByPlayer.Remove(Player);
+	}
+	else
+	{
+		AimedRecordByPlayer.Add(Player, RecordId);
+	}
+	
+	ShowAimedRecordHighlight(Player);
+}
+
+int32 ABuildableAutoSupportRegion::GetAimedRecord(const AFGCharacterPlayer* Player) const
+{
+	const auto* AimedRecordId = Player ? AimedRecordByPlayer.Find(Player) : nullptr;
+	return AimedRecordId ? *AimedRecordId : INDEX_NONE;
+}
+
+void ABuildableAutoSupportRegion::ShowAimedRecordHighlight(AFGCharacterPlayer* Player)
+{
+	if (!Player)
+	{
+		return;
+	}
+	
+	const auto* Record = FindRecord(GetAimedRecord(Player));
+	auto* Outline = Player->GetOutline();
+
+	if (!Record)
+	{
+		if (UBuildableAutoSupportPreviewComponent* Highlight; DismantleHighlightByPlayer.RemoveAndCopyValue(Player, Highlight) && Highlight)
+		{
+			Highlight->DestroyComponent();
+		}
+
+		if (Outline)
+		{
+			Outline->HideOutline(this);
+		}
+
+		return;
+	}
+
+	auto& Highlight = DismantleHighlightByPlayer.FindOrAdd(Player);
+	
+	if (!Highlight)
+	{
+		Highlight = NewObject<UBuildableAutoSupportPreviewComponent>(this);
+		Highlight->bOutlineOnly = true;
+		Highlight->SetupAttachment(RootComponent);
+		Highlight->RegisterComponent();
+	}
+
+	TArray<FAutoSupportPlannedPart> Parts;
+	Parts.Reserve(Record->Handles.Num());
+
+	for (const auto& Handle : Record->Handles)
+	{
+		auto& Part = Parts.AddDefaulted_GetRef();
+		Part.BuildableClass = Handle.GetBuildableClass();
+		Part.RelativeTransform = Handle.GetTransform().GetRelativeTransform(Record->Transform);
+	}
+
+	Highlight->ShowParts(Parts, Record->Transform);
+
+	if (Outline)
+	{
+		Outline->ShowOutline(this, EOutlineColor::OC_RED);
+	}
+}
+
+void ABuildableAutoSupportRegion::OnBuildModeUpdate(const TSubclassOf<UFGBuildGunModeDescriptor> BuildMode)
+{
+	const auto* BuildGunExtensions = UAutoSupportBuildGunExtensionsModule::Get(GetWorld());
+	const auto bIsProxyDismantleMode = BuildMode && BuildGunExtensions && BuildMode == BuildGunExtensions->ProxyDismantleMode;
+
+	RecordCollisionComponent->SetCollisionEnabled(bIsProxyDismantleMode ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
+}
+
+FTransform ABuildableAutoSupportRegion::GetCollisionInstanceTransform(const FAutoSupportRegionRecord& Record) const
+{
+	// A box over the record bounds, oriented like the support.
+	const auto Scale = Record.LocalBounds.GetExtent() / RecordCollisionMeshExtent;
+	const FTransform WorldTransform(Record.Transform.GetRotation(), Record.Transform.TransformPosition(Record.LocalBounds.GetCenter()), Scale);
+
+	return WorldTransform.GetRelativeTransform(GetActorTransform());
+}
+
+void ABuildableAutoSupportRegion::RebuildRecordIndex()
+{
+	RecordIndexById.Reset();
+	RecordIndexById.Reserve(Records.Num());
+
+	for (auto i = 0; i < Records.Num(); ++i)
+	{
+		RecordIndexById.Add(Records[i].RecordId, i);
+	}
+}
+
+void ABuildableAutoSupportRegion::RebuildCollisionInstances()
+{
+	TArray<FTransform> InstanceTransforms;
+	InstanceTransforms.Reserve(Records.Num());
+
+	for (const auto& Record : Records)
+	{
+		InstanceTransforms.Add(GetCollisionInstanceTransform(Record));
+	}
+
+	RecordCollisionComponent->ClearInstances();
+	RecordCollisionComponent->AddInstances(InstanceTransforms, false);
+}
+
+#pragma region IFGSaveInterface
+
+bool ABuildableAutoSupportRegion::NeedTransform_Implementation()
+{
+	return true;
+}
+
+bool ABuildableAutoSupportRegion::ShouldSave_Implementation() const
+{
+	return true;
+}
+
+void ABuildableAutoSupportRegion::PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	for (auto& Record : Records)
+	{
+		FAutoSupportHandleCodec::Encode(Record.Handles, Record.Transform, Record.SavedHandleClasses, Record.SavedHandleBuildables, Record.SavedHandleData);
+	}
+}
+
+void ABuildableAutoSupportRegion::PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	for (auto& Record : Records)
+	{
+		Record.SavedHandleClasses.Empty();
+		Record.SavedHandleBuildables.Empty();
+		Record.SavedHandleData.Empty();
+	}
+}
+
+void ABuildableAutoSupportRegion::PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	for (auto& Record : Records)
+	{
+		if (!FAutoSupportHandleCodec::Decode(Record.SavedHandleData, Record.Transform, Record.SavedHandleClasses, Record.SavedHandleBuildables, Record.Handles))
+		{
+			MOD_LOG(Error, TEXT("Failed to decode the saved handles of record %i."), Record.RecordId)
+		}
+
+		Record.SavedHandleClasses.Empty();
+		Record.SavedHandleBuildables.Empty();
+		Record.SavedHandleData.Empty();
+	}
+}
+
+#pragma endregion
+
+#pragma region IFGDismantleInterface
+
+const FAutoSupportRegionRecord* ABuildableAutoSupportRegion::FindLocallyAimedRecord() const
+{
+	for (const auto& Entry : AimedRecordByPlayer)
+	{
+		if (const auto* Record = FindRecord(Entry.Value))
+		{
+			return Record;
+		}
+	}
+
+	return nullptr;
+}
+
+void ABuildableAutoSupportRegion::DismantleRecord(const int32 RecordId, AFGCharacterPlayer* Player)
+{
+	fgcheck(Player);
+	fgcheck(HasAuthority());
+	
+	const auto* Record = FindRecord(RecordId);
+	if (!Record)
+	{
+		MOD_LOG(Verbose, TEXT("Record %i is gone already, nothing to dismantle."), RecordId)
+		return;
+	}
+
+	MOD_LOG(Verbose, TEXT("Dismantling record %i with %i parts."), Record->RecordId, Record->Handles.Num())
+
+	auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld());
+	
+	// Summed before anything is dismantled, the refund asks the parts what they were built with.
+	TArray<FInventoryStack> Refund;
+	
+	if (!Player->GetInventory()->GetNoBuildCost())
+	{
+		SupportSubsys->GetHandlesRefund(Record->Handles, Refund);
+	}
+
+	// Unlink first so the parts' removal doesn't come back to the record.
+	const auto Handles = Record->Handles;
+	const auto CrateLocation = Record->GetWorldBounds().GetCenter();
+
+	RemoveRecord(RecordId);
+	SupportSubsys->DismantleHandleParts(Handles);
+	SupportSubsys->GiveDismantleRefund(Player, Refund, CrateLocation);
+}
+
+bool ABuildableAutoSupportRegion::CanDismantle_Implementation() const
+{
+	// Aimable as a whole, the build gun extensions send the aimed record to DismantleRecord.
+	return !Records.IsEmpty();
+}
+
+FText ABuildableAutoSupportRegion::GetDismantleDisplayName_Implementation(AFGCharacterPlayer* byCharacter) const
+{
+	return FText::FromString(FString("Auto Support"));
+}
+
+void ABuildableAutoSupportRegion::StartIsLookedAtForDismantle_Implementation(AFGCharacterPlayer* byCharacter)
+{
+	ShowAimedRecordHighlight(byCharacter);
+}
+
+void ABuildableAutoSupportRegion::StopIsLookedAtForDismantle_Implementation(AFGCharacterPlayer* byCharacter)
+{
+	AimedRecordByPlayer.Remove(byCharacter);
+	ShowAimedRecordHighlight(byCharacter);
+}
+
+void ABuildableAutoSupportRegion::Dismantle_Implementation()
+{
+	// The vanilla dismantle doesn't know which record was aimed at. The build gun extensions cancel it for regions and dismantle the aimed
+	// record through DismantleRecord instead, so this is only reached by a dismantle that bypassed them.
+	MOD_LOG(Warning, TEXT("Dismantle called on a region. Records are dismantled through DismantleRecord, ignoring."))
+}
+
+void ABuildableAutoSupportRegion::GetChildDismantleActors_Implementation(TArray<AActor*>& out_ChildDismantleActors) const
+{
+	// None. The aimed at record's parts are refunded from their handles and dismantled by DismantleRecord.
+}
+
+void ABuildableAutoSupportRegion::GetDismantleDependencies_Implementation(TArray<AActor*>& out_dismantleDependencies) const
+{
+}
+
+void ABuildableAutoSupportRegion::GetDismantleDisqualifiers_Implementation(
+	TArray<TSubclassOf<UFGConstructDisqualifier>>& out_dismantleDisqualifiers,
+	const TArray<AActor*>& allSelectedActors) const
+{
+}
+
+void ABuildableAutoSupportRegion::GetDismantleRefund_Implementation(TArray<FInventoryStack>& out_refund, bool noBuildCostEnabled) const
+{
+	// Only shown. The refund given is summed by DismantleRecord from the record the client sent.
+	const auto* Record = FindLocallyAimedRecord();
+
+	if (noBuildCostEnabled || !Record)
+	{
+		return;
+	}
+
+	if (auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld()))
+	{
+		SupportSubsys->GetHandlesRefund(Record->Handles, out_refund);
+	}
+}
+
+FVector ABuildableAutoSupportRegion::GetRefundSpawnLocationAndArea_Implementation(const FVector& aimHitLocation, float& out_radius) const
+{
+	if (const auto* Record = FindLocallyAimedRecord())
+	{
+		const auto WorldBounds = Record->GetWorldBounds();
+		out_radius = WorldBounds.GetExtent().Size2D();
+		return WorldBounds.GetCenter();
+	}
+
+	out_radius = 0.f;
+	return aimHitLocation;
+}
+
+void ABuildableAutoSupportRegion::PreUpgrade_Implementation()
+{
+}
+
+bool ABuildableAutoSupportRegion::ShouldBlockDismantleSample_Implementation() const
+{
+	return false;
+}
+
+bool ABuildableAutoSupportRegion::SupportsDismantleDisqualifiers_Implementation() const
+{
+	return true;
+}
+
+void ABuildableAutoSupportRegion::Upgrade_Implementation(AActor* newActor)
+{
+}
+
+#pragma endregion
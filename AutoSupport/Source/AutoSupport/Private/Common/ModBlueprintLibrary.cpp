@@ -149,64 +149,127 @@ AFGHologram* UAutoSupportBlueprintLibrary::CreateCompositeHologramFromPlan(
 	AActor* Parent,
 	AActor* Owner,
 	ABuildableAutoSupportProxy*& OutProxy)
+{
+	FAutoSupportPreparedBuild Build;
+	PrepareBuild(Plan, GetPlanProxyTransform(Plan, Parent), Build);
+
+	return CreateCompositeHologramFromPreparedBuild(Build, ProxyClass, BuildInstigator, Owner, OutProxy);
+}
+
+AFGHologram* UAutoSupportBlueprintLibrary::CreateCompositeHologramFromPreparedBuild(
+	const FAutoSupportPreparedBuild& Build,
+	TSubclassOf<ABuildableAutoSupportProxy> ProxyClass,
+	APawn* BuildInstigator,
+	AActor* Owner,
+	ABuildableAutoSupportProxy*& OutProxy)
 {
 	fgcheck(BuildInstigator)
+	fgcheck(!Build.IsEmpty())
 
-	// TODO(k.a): understand the rotation calculation better. I trialed and errored for a bit. Need a visualization.
-	// Rotation: Calculate the world rot from the following rotations. Reminder: right most are applied first.
 	// NOTE: Changing rotation between SpawnActorDeferred and FinishingSpawning can be a recipe for disaster.
-	const auto WorldRot =
-		(Parent ? Parent->GetActorRotation().Quaternion() : FQuat::Identity) // world rotation
-		* GetForwardVectorRotator(Plan.BuildDirection).Quaternion() // forward vector rotation of the build direction, but relative to the build dir rot
-		* Plan.RelativeRotation; // relative rotation of the build direction
-
-	const FTransform ProxyTransform(WorldRot, Plan.StartWorldLocation);
-	
 	// Spawn a proxy container for the parts.
 	auto* SupportProxy = BuildInstigator->GetWorld()->SpawnActorDeferred<ABuildableAutoSupportProxy>(
 		ProxyClass,
-		ProxyTransform, // place it at the origin of the trace
+		Build.ProxyTransform, // place it at the origin of the trace
 		nullptr,
 		BuildInstigator);
 	SupportProxy->bIsNewlySpawned = true;
 
-	FBox LocalBoundingBox(ForceInit);
-
 	OutProxy = SupportProxy;
 	
-	// Build the parts
-	auto WorkingTransform = FTransform::Identity; // Build the holograms in relative space
-	AFGHologram* RootHologram = nullptr; // we'll assign this while building
+	// Build the parts. The holograms are built in relative space.
+	AFGHologram* RootHologram = nullptr;
 	
-	if (Plan.StartPart.IsActionable())
-	{
-		MOD_LOG(Verbose, TEXT("Building Start Part, Orientation: [%s]"), TEXT_ENUM(Plan.StartPart.Orientation));
-		SpawnPartPlanHolograms(RootHologram, Plan.StartPart, BuildInstigator, SupportProxy, Owner, WorkingTransform, LocalBoundingBox);
-	}
-
-	if (Plan.MidPart.IsActionable())
+	for (const auto& Part : Build.Parts)
 	{
-		MOD_LOG(Verbose, TEXT("Building Mid Parts, Orientation: [%s]"), TEXT_ENUM(Plan.EndPart.Orientation));
-		SpawnPartPlanHolograms(RootHologram, Plan.MidPart, BuildInstigator, SupportProxy, Owner, WorkingTransform, LocalBoundingBox);
-	}
+		MOD_LOG(Verbose, TEXT("Part Spawn Transform: [%s]"), *Part.RelativeTransform.ToHumanReadableString());
 
-	if (Plan.EndPart.IsActionable())
-	{
-		MOD_LOG(Verbose, TEXT("Building End Part, Orientation: [%s]"), TEXT_ENUM(Plan.EndPart.Orientation));
-		WorkingTransform.AddToTranslation(FVector::UpVector * Plan.EndPartPositionOffset);
+		auto PreSpawnFn = [&Part](AFGHologram* PreSpawnHolo)
+		{
+			PreSpawnHolo->SetActorRotation(Part.RelativeTransform.GetRotation());
+			PreSpawnHolo->DoMultiStepPlacement(false);
+		};
 		
-		SpawnPartPlanHolograms(RootHologram, Plan.EndPart, BuildInstigator, SupportProxy, Owner, WorkingTransform, LocalBoundingBox);
+		if (RootHologram)
+		{
+			auto* Hologram = AFGHologram::SpawnChildHologramFromRecipe(
+				RootHologram,
+				FName(FGuid::NewGuid().ToString()),
+				Part.BuildRecipeClass,
+				Owner,
+				Part.RelativeTransform.GetLocation(),
+				PreSpawnFn);
+
+			Hologram->AttachToActor(SupportProxy, FAttachmentTransformRules::KeepRelativeTransform);
+		}
+		else
+		{
+			RootHologram = AFGHologram::SpawnHologramFromRecipe(
+				Part.BuildRecipeClass,
+				Owner,
+				Part.RelativeTransform.GetLocation(),
+				BuildInstigator,
+				PreSpawnFn);
+
+			RootHologram->SetShouldSpawnChildHolograms(true);
+			RootHologram->AttachToActor(SupportProxy, FAttachmentTransformRules::KeepRelativeTransform);
+		}
 	}
 
 	fgcheck(RootHologram)
 
-	LocalBoundingBox = LocalBoundingBox.ExpandBy(0.5f); // pad a little to avoid z fighting. 
+	MOD_LOG(Verbose, TEXT("Local Bounding Box: [%s]"), *Build.LocalBounds.ToString())
+	
+	SupportProxy->UpdateBoundingBox(Build.LocalBounds);
 
-	MOD_LOG(Verbose, TEXT("Local Bounding Box: [%s]"), *LocalBoundingBox.ToString())
+	return RootHologram;
+}
 
-	LocalBoundingBox.IsValid = true; // ...
+AFGHologram* UAutoSupportBlueprintLibrary::CreateWorldCompositeHologramFromPreparedBuild(
+	const FAutoSupportPreparedBuild& Build,
+	APawn* BuildInstigator,
+	AActor* Owner)
+{
+	fgcheck(BuildInstigator)
+	fgcheck(!Build.IsEmpty())
+
+	// No proxy to attach to, so the holograms are built in world space.
+	AFGHologram* RootHologram = nullptr;
 	
-	SupportProxy->UpdateBoundingBox(LocalBoundingBox);
+	for (const auto& Part : Build.Parts)
+	{
+		const auto WorldTransform = Part.RelativeTransform * Build.ProxyTransform;
+		
+		auto PreSpawnFn = [&WorldTransform](AFGHologram* PreSpawnHolo)
+		{
+			PreSpawnHolo->SetActorRotation(WorldTransform.GetRotation());
+			PreSpawnHolo->DoMultiStepPlacement(false);
+		};
+		
+		if (RootHologram)
+		{
+			AFGHologram::SpawnChildHologramFromRecipe(
+				RootHologram,
+				FName(FGuid::NewGuid().ToString()),
+				Part.BuildRecipeClass,
+				Owner,
+				WorldTransform.GetLocation(),
+				PreSpawnFn);
+		}
+		else
+		{
+			RootHologram = AFGHologram::SpawnHologramFromRecipe(
+				Part.BuildRecipeClass,
+				Owner,
+				WorldTransform.GetLocation(),
+				BuildInstigator,
+				PreSpawnFn);
+
+			RootHologram->SetShouldSpawnChildHolograms(true);
+		}
+	}
+
+	fgcheck(RootHologram)
 
 	return RootHologram;
 }
@@ -365,6 +428,46 @@ void UAutoSupportBlueprintLibrary::PlanBuild(UWorld* World, const FAutoSupportTr
 	CalculateTotalCost(OutPlan);
 }
 
+FTransform UAutoSupportBlueprintLibrary::GetPlanProxyTransform(const FAutoSupportBuildPlan& Plan, const AActor* Parent)
+{
+	// TODO(k.a): understand the rotation calculation better. I trialed and errored for a bit. Need a visualization.
+	// Rotation: Calculate the world rot from the following rotations. Reminder: right most are applied first.
+	const auto WorldRot =
+		(Parent ? Parent->GetActorRotation().Quaternion() : FQuat::Identity) // world rotation
+		* GetForwardVectorRotator(Plan.BuildDirection).Quaternion() // forward vector rotation of the build direction, but relative to the build dir rot
+		* Plan.RelativeRotation; // relative rotation of the build direction
+
+	return FTransform(WorldRot, Plan.StartWorldLocation);
+}
+
+void UAutoSupportBlueprintLibrary::PrepareBuild(const FAutoSupportBuildPlan& Plan, const FTransform& ProxyTransform, FAutoSupportPreparedBuild& OutBuild)
+{
+	OutBuild.ProxyTransform = ProxyTransform;
+	OutBuild.Parts.Reset();
+	OutBuild.LocalBounds = FBox(ForceInit);
+	
+	auto WorkingLocation = FVector::ZeroVector;
+	
+	if (Plan.StartPart.IsActionable())
+	{
+		PreparePartPlan(Plan.StartPart, WorkingLocation, OutBuild);
+	}
+
+	if (Plan.MidPart.IsActionable())
+	{
+		PreparePartPlan(Plan.MidPart, WorkingLocation, OutBuild);
+	}
+
+	if (Plan.EndPart.IsActionable())
+	{
+		WorkingLocation += FVector::UpVector * Plan.EndPartPositionOffset;
+		PreparePartPlan(Plan.EndPart, WorkingLocation, OutBuild);
+	}
+
+	OutBuild.LocalBounds = OutBuild.LocalBounds.ExpandBy(0.5f); // pad a little to avoid z fighting.
+	OutBuild.LocalBounds.IsValid = true; // ...
+}
+
 bool UAutoSupportBlueprintLibrary::IsPlanActionable(const FAutoSupportBuildPlan& Plan)
 {
 	return Plan.IsActionable();
@@ -749,67 +852,30 @@ bool UAutoSupportBlueprintLibrary::IsValidAutoSupportPresetName(FString PresetNa
 
 #pragma region Private
 
-void UAutoSupportBlueprintLibrary::SpawnPartPlanHolograms(
-	AFGHologram*& ParentHologram,
+void UAutoSupportBlueprintLibrary::PreparePartPlan(
 	const FAutoSupportBuildPlanPartData& PartPlan,
-	APawn* BuildInstigator,
-	AActor* Parent,
-	AActor* Owner,
-	FTransform& WorkingTransform,
-	FBox& WorkingBBox)
+	FVector& WorkingLocation,
+	FAutoSupportPreparedBuild& OutBuild)
 {
-	auto PreSpawnFn = [&](AFGHologram* PreSpawnHolo)
-	{
-		PreSpawnHolo->AddActorWorldRotation(PartPlan.LocalRotation);
-		PreSpawnHolo->AddActorWorldOffset(PartPlan.LocalTranslation);
-		PreSpawnHolo->DoMultiStepPlacement(false);
-	};
-
 	const auto PartExtent = PartPlan.BBox.GetExtent();
+	auto& Bounds = OutBuild.LocalBounds;
 	
-	WorkingBBox.Min.X = FMath::Min(WorkingBBox.Min.X, -PartExtent.X);
-	WorkingBBox.Min.Y = FMath::Min(WorkingBBox.Min.Y, -PartExtent.Y);
+	Bounds.Min.X = FMath::Min(Bounds.Min.X, -PartExtent.X);
+	Bounds.Min.Y = FMath::Min(Bounds.Min.Y, -PartExtent.Y);
 		
-	WorkingBBox.Max.X = FMath::Max(WorkingBBox.Max.X, PartExtent.X);
-	WorkingBBox.Max.Y = FMath::Max(WorkingBBox.Max.Y, PartExtent.Y);
+	Bounds.Max.X = FMath::Max(Bounds.Max.X, PartExtent.X);
+	Bounds.Max.Y = FMath::Max(Bounds.Max.Y, PartExtent.Y);
 	
 	for (auto i = 0; i < PartPlan.Count; ++i)
 	{
-		// Copy the transform, then apply the orientation below
-		MOD_LOG(Verbose, TEXT("World Part Spawn Transform: [%s]"), *WorkingTransform.ToHumanReadableString());
-		
-		if (ParentHologram)
-		{
-			auto* Hologram = AFGHologram::SpawnChildHologramFromRecipe(
-				ParentHologram,
-				FName(FGuid::NewGuid().ToString()),
-				PartPlan.BuildRecipeClass,
-				Owner,
-				WorkingTransform.GetLocation(),
-				PreSpawnFn);
-
-			Hologram->AttachToActor(Parent, FAttachmentTransformRules::KeepRelativeTransform);
-		}
-		else
-		{
-			ParentHologram = AFGHologram::SpawnHologramFromRecipe(
-				PartPlan.BuildRecipeClass,
-				Owner,
-				WorkingTransform.GetLocation(),
-				BuildInstigator,
-				PreSpawnFn);
+		auto& Part = OutBuild.Parts.AddDefaulted_GetRef();
+		Part.BuildableClass = PartPlan.BuildableClass;
+		Part.BuildRecipeClass = PartPlan.BuildRecipeClass;
+		Part.CustomizationData = PartPlan.CustomizationData;
+		Part.RelativeTransform = FTransform(PartPlan.LocalRotation, WorkingLocation + PartPlan.LocalTranslation);
 
-			ParentHologram->SetShouldSpawnChildHolograms(true);
-			ParentHologram->AttachToActor(Parent, FAttachmentTransformRules::KeepRelativeTransform);
-		}
-
-		// Update the BBox
-		WorkingBBox.Max.Z += PartPlan.ConsumedBuildSpace;
-		
-		// Update the transform
-		WorkingTransform.AddToTranslation(FVector::UpVector * PartPlan.ConsumedBuildSpace); 
-		
-		MOD_LOG(Verbose, TEXT("Next Transform: [%s]"), *WorkingTransform.ToHumanReadableString());
+		Bounds.Max.Z += PartPlan.ConsumedBuildSpace;
+		WorkingLocation += FVector::UpVector * PartPlan.ConsumedBuildSpace;
 	}
 }
 
@@ -5,6 +5,8 @@
 #include "FGLightweightBuildableSubsystem.h"
 #include "ModDefines.h"
 #include "ModLogging.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
 FAutoSupportBuildableHandle::FAutoSupportBuildableHandle(AFGBuildable* Buildable)
 {
@@ -20,35 +22,104 @@ FAutoSupportBuildableHandle::FAutoSupportBuildableHandle(const FLightweightBuild
 	SetTransform(LightweightRef.GetBuildableTransform());
 }
 
+FAutoSupportBuildableHandle::FAutoSupportBuildableHandle(const TSubclassOf<AFGBuildable> BuildableClass, const FTransform& Transform)
+{
+	this->BuildableClass = BuildableClass;
+	SetTransform(Transform);
+}
+
+namespace
+{
+	constexpr int32 LocationCellMax = (1 << FAutoSupportBuildableHandle::LocationKeyAxisBits) - 1;
+	constexpr int32 LocationCellOffset = 1 << (FAutoSupportBuildableHandle::LocationKeyAxisBits - 1);
+
+	int32 GetLocationCell(const double Coordinate)
+	{
+		const auto Cell = FMath::FloorToInt64(Coordinate / AUTOSUPPORT_HANDLE_GRID_SIZE) + LocationCellOffset;
+		return static_cast<int32>(FMath::Clamp<int64>(Cell, 0, LocationCellMax));
+	}
+	
+	// Spreads the low 21 bits of the value so there are two zero bits between each.
+	uint64 SpreadBits(const uint64 Value)
+	{
+		auto Spread = Value & 0x1fffff;
+		Spread = (Spread | Spread << 32) & 0x1f00000000ffff;
+		Spread = (Spread | Spread << 16) & 0x1f0000ff0000ff;
+		Spread = (Spread | Spread << 8) & 0x100f00f00f00f00f;
+		Spread = (Spread | Spread << 4) & 0x10c30c30c30c30c3;
+		Spread = (Spread | Spread << 2) & 0x1249249249249249;
+		return Spread;
+	}
+
+	uint64 InterleaveCells(const int32 X, const int32 Y, const int32 Z)
+	{
+		return SpreadBits(X) | SpreadBits(Y) << 1 | SpreadBits(Z) << 2;
+	}
+}
+
 void FAutoSupportBuildableHandle::SetTransform(const FTransform& NewTransform)
 {
 	this->Transform = NewTransform;
+	this->LocationKey = MakeLocationKey(NewTransform.GetLocation());
+}
 
-	FInt64Vector3 RoundedLocation;
-	GetRoundedLocation(NewTransform.GetLocation(), RoundedLocation);
-	
-	this->TransformHash = GetTypeHash(RoundedLocation);
+uint64 FAutoSupportBuildableHandle::MakeLocationKey(const FVector& Location)
+{
+	return InterleaveCells(GetLocationCell(Location.X), GetLocationCell(Location.Y), GetLocationCell(Location.Z));
+}
+
+void FAutoSupportBuildableHandle::GetToleranceProbeKeys(TArray<uint64, TInlineAllocator<8>>& OutKeys) const
+{
+	GetToleranceProbeKeys(Transform.GetLocation(), OutKeys);
 }
 
-void FAutoSupportBuildableHandle::GetRoundedLocation(const FVector& Location, FInt64Vector3& OutLocation)
+void FAutoSupportBuildableHandle::GetToleranceProbeKeys(const FVector& Location, TArray<uint64, TInlineAllocator<8>>& OutKeys)
 {
-	constexpr auto Int64Min = static_cast<float>(TNumericLimits<int64>::Min());
-	constexpr auto Int64Max = static_cast<float>(TNumericLimits<int64>::Max());
+	OutKeys.Reset();
+	
+	// For each axis, the cells the location could fall in when moved by up to the tolerance.
+	int32 Cells[3][2];
+	int32 NumCells[3];
 
-	const auto Xish = static_cast<int64>(FMath::Clamp(Location.X, Int64Min, Int64Max));
-	const auto Yish = static_cast<int64>(FMath::Clamp(Location.Y, Int64Min, Int64Max));
-	const auto Zish = static_cast<int64>(FMath::Clamp(Location.Z, Int64Min, Int64Max));
+	for (auto Axis = 0; Axis < 3; ++Axis)
+	{
+		const auto Cell = GetLocationCell(Location[Axis]);
+		const auto LowCell = GetLocationCell(Location[Axis] - AUTOSUPPORT_TRANSFORM_EQUALITY_TOLERANCE);
+		const auto HighCell = GetLocationCell(Location[Axis] + AUTOSUPPORT_TRANSFORM_EQUALITY_TOLERANCE);
 
-	OutLocation = FInt64Vector3(Xish, Yish, Zish);
+		Cells[Axis][0] = Cell;
+		NumCells[Axis] = 1;
+
+		if (LowCell != Cell)
+		{
+			Cells[Axis][NumCells[Axis]++] = LowCell;
+		}
+		else if (HighCell != Cell)
+		{
+			Cells[Axis][NumCells[Axis]++] = HighCell;
+		}
+	}
+
+	for (auto X = 0; X < NumCells[0]; ++X)
+	{
+		for (auto Y = 0; Y < NumCells[1]; ++Y)
+		{
+			for (auto Z = 0; Z < NumCells[2]; ++Z)
+			{
+				OutKeys.Add(InterleaveCells(Cells[0][X], Cells[1][Y], Cells[2][Z]));
+			}
+		}
+	}
 }
 
 bool FAutoSupportBuildableHandle::Equals(const FAutoSupportBuildableHandle& Other) const
 {
-	if (BuildableClass != Other.BuildableClass)
+	if (BuildableClass != Other.BuildableClass || LocationKey != Other.LocationKey)
 	{
-		return false; // different class
+		return false; // different class or grid cell
 	}
 
+	// The key only narrows it down, a cell is wider than the tolerance and clamped cells at the edge of the key range hold any location.
 	if (!Transform.Equals(Other.Transform, AUTOSUPPORT_TRANSFORM_EQUALITY_TOLERANCE))
 	{
 		return false; // different transforms
@@ -74,10 +145,270 @@ bool FAutoSupportBuildableHandle::Equals(const FAutoSupportBuildableHandle& Othe
 FString FAutoSupportBuildableHandle::ToString() const
 {
 	return FString::Printf(
-		TEXT("Class: [%s], IsConsideredLightweight: [%s], BuildableInstValid: [%s], TransformHash: [%d] Transform: [%s]"),
+		TEXT("Class: [%s], IsConsideredLightweight: [%s], BuildableInstValid: [%s], LocationKey: [%llu] Transform: [%s]"),
 		TEXT_CLS_NAME(BuildableClass),
 		TEXT_BOOL(Buildable.IsValid()),
 		TEXT_BOOL(IsConsideredLightweight()),
-		TransformHash,
+		LocationKey,
 		TEXT_STR(Transform.ToString()));
 }
+
+void FAutoSupportHandleCodec::Encode(
+	const TArray<FAutoSupportBuildableHandle>& Handles,
+	const FTransform& BaseTransform,
+	TArray<TSubclassOf<AFGBuildable>>& OutClasses,
+	TArray<TWeakObjectPtr<AFGBuildable>>& OutBuildables,
+	TArray<uint8>& OutData)
+{
+	OutClasses.Reset();
+	OutBuildables.Reset();
+	OutData.Reset();
+
+	TArray<FQuat4f> Rotations;
+	TArray<FVector3f> Scales;
+	
+	struct FEncodedPart
+	{
+		int32 ClassIndex;
+		int32 RotationIndex;
+		int32 ScaleIndex;
+		FIntVector Offset;
+		int32 BuildableIndex;
+	};
+
+	TArray<FEncodedPart> Parts;
+	Parts.Reserve(Handles.Num());
+	
+	for (const auto& Handle : Handles)
+	{
+		const auto RelativeTransform = Handle.GetTransform().GetRelativeTransform(BaseTransform);
+		const auto RelativeRotation = FQuat4f(RelativeTransform.GetRotation());
+		const auto RelativeLocation = RelativeTransform.GetLocation();
+		const auto RelativeScale = FVector3f(RelativeTransform.GetScale3D());
+		
+		auto& Part = Parts.AddDefaulted_GetRef();
+		Part.ClassIndex = OutClasses.AddUnique(Handle.GetBuildableClass());
+		Part.RotationIndex = Rotations.IndexOfByPredicate([&RelativeRotation](const FQuat4f& Rotation)
+		{
+			return Rotation.Equals(RelativeRotation, UE_KINDA_SMALL_NUMBER);
+		});
+
+		if (Part.RotationIndex == INDEX_NONE)
+		{
+			Part.RotationIndex = Rotations.Add(RelativeRotation);
+		}
+
+		// Most parts are at unit scale and store no scale index.
+		Part.ScaleIndex = RelativeScale.Equals(FVector3f::OneVector, UE_KINDA_SMALL_NUMBER) ? INDEX_NONE : Scales.AddUnique(RelativeScale);
+
+		Part.Offset = QuantizeOffset(RelativeLocation);
+		Part.BuildableIndex = Handle.IsConsideredLightweight() ? INDEX_NONE : OutBuildables.Add(Handle.Buildable);
+	}
+
+	FMemoryWriter Writer(OutData);
+	
+	auto EncodedVersion = Version;
+	Writer << EncodedVersion;
+
+	auto NumRotations = static_cast<uint32>(Rotations.Num());
+	Writer.SerializeIntPacked(NumRotations);
+	
+	for (auto& Rotation : Rotations)
+	{
+		Writer << Rotation.X << Rotation.Y << Rotation.Z << Rotation.W;
+	}
+
+	auto NumScales = static_cast<uint32>(Scales.Num());
+	Writer.SerializeIntPacked(NumScales);
+	
+	for (auto& Scale : Scales)
+	{
+		Writer << Scale.X << Scale.Y << Scale.Z;
+	}
+
+	auto NumParts = static_cast<uint32>(Parts.Num());
+	Writer.SerializeIntPacked(NumParts);
+
+	for (auto& Part : Parts)
+	{
+		auto BuildableIndexPlusOne = Part.BuildableIndex + 1;
+		auto RotationIndexAndScaleFlag = (Part.RotationIndex << 1) | (Part.ScaleIndex != INDEX_NONE ? 1 : 0);
+		
+		SerializeSigned(Writer, Part.ClassIndex);
+		SerializeSigned(Writer, RotationIndexAndScaleFlag);
+
+		if (Part.ScaleIndex != INDEX_NONE)
+		{
+			SerializeSigned(Writer, Part.ScaleIndex);
+		}
+		
+		SerializeSigned(Writer, Part.Offset.X);
+		SerializeSigned(Writer, Part.Offset.Y);
+		SerializeSigned(Writer, Part.Offset.Z);
+		SerializeSigned(Writer, BuildableIndexPlusOne);
+	}
+}
+
+bool FAutoSupportHandleCodec::Decode(
+	const TArray<uint8>& Data,
+	const FTransform& BaseTransform,
+	const TArray<TSubclassOf<AFGBuildable>>& Classes,
+	const TArray<TWeakObjectPtr<AFGBuildable>>& Buildables,
+	TArray<FAutoSupportBuildableHandle>& OutHandles)
+{
+	if (Data.IsEmpty())
+	{
+		OutHandles.Reset();
+		return true;
+	}
+	
+	FMemoryReader Reader(Data);
+
+	uint8 EncodedVersion = 0;
+	Reader << EncodedVersion;
+
+	if (EncodedVersion == 0 || EncodedVersion > Version)
+	{
+		MOD_LOG(Error, TEXT("Unknown handle encoding version [%i]."), EncodedVersion)
+		return false;
+	}
+
+	const auto bHasScales = EncodedVersion >= 2;
+
+	// The counts come from save data. Each entry takes at least its minimum encoded size, so a count the remaining data cannot hold is
+	// corrupt and must not be allocated for.
+	const auto CanHold = [&Reader](const uint32 Count, const int64 MinBytesEach)
+	{
+		return !Reader.IsError() && Count <= static_cast<uint64>(Reader.TotalSize() - Reader.Tell()) / MinBytesEach;
+	};
+
+	uint32 NumRotations = 0;
+	Reader.SerializeIntPacked(NumRotations);
+
+	if (!CanHold(NumRotations, sizeof(float) * 4))
+	{
+		MOD_LOG(Error, TEXT("Malformed handle data, [%u] rotations."), NumRotations)
+		return false;
+	}
+
+	TArray<FQuat4f> Rotations;
+	Rotations.SetNumUninitialized(NumRotations);
+	
+	for (auto& Rotation : Rotations)
+	{
+		Reader << Rotation.X << Rotation.Y << Rotation.Z << Rotation.W;
+	}
+
+	uint32 NumScales = 0;
+	
+	if (bHasScales)
+	{
+		Reader.SerializeIntPacked(NumScales);
+	}
+
+	if (!CanHold(NumScales, sizeof(float) * 3))
+	{
+		MOD_LOG(Error, TEXT("Malformed handle data, [%u] scales."), NumScales)
+		return false;
+	}
+
+	TArray<FVector3f> Scales;
+	Scales.SetNumUninitialized(NumScales);
+	
+	for (auto& Scale : Scales)
+	{
+		Reader << Scale.X << Scale.Y << Scale.Z;
+	}
+
+	uint32 NumParts = 0;
+	Reader.SerializeIntPacked(NumParts);
+
+	// Six packed ints per part, at least a byte each.
+	if (!CanHold(NumParts, 6))
+	{
+		MOD_LOG(Error, TEXT("Malformed handle data, [%u] parts."), NumParts)
+		return false;
+	}
+
+	TArray<FAutoSupportBuildableHandle> Handles;
+	Handles.Reserve(NumParts);
+	
+	for (uint32 i = 0; i < NumParts; ++i)
+	{
+		int32 ClassIndex, RotationIndex, BuildableIndexPlusOne;
+		FIntVector Offset;
+		auto ScaleIndex = INDEX_NONE;
+		
+		SerializeSigned(Reader, ClassIndex);
+		SerializeSigned(Reader, RotationIndex);
+
+		if (bHasScales)
+		{
+			if (RotationIndex & 1)
+			{
+				SerializeSigned(Reader, ScaleIndex);
+			}
+			
+			RotationIndex >>= 1;
+		}
+		
+		SerializeSigned(Reader, Offset.X);
+		SerializeSigned(Reader, Offset.Y);
+		SerializeSigned(Reader, Offset.Z);
+		SerializeSigned(Reader, BuildableIndexPlusOne);
+
+		const auto BuildableIndex = BuildableIndexPlusOne - 1;
+		
+		if (Reader.IsError() || !Classes.IsValidIndex(ClassIndex) || !Rotations.IsValidIndex(RotationIndex) || (ScaleIndex != INDEX_NONE && !Scales.IsValidIndex(ScaleIndex)) || (BuildableIndex != INDEX_NONE && !Buildables.IsValidIndex(BuildableIndex)))
+		{
+			MOD_LOG(Error, TEXT("Malformed handle data at part [%i]."), i)
+			return false;
+		}
+
+		const FTransform RelativeTransform(
+			FQuat(Rotations[RotationIndex]),
+			DequantizeOffset(Offset),
+			ScaleIndex != INDEX_NONE ? FVector(Scales[ScaleIndex]) : FVector::OneVector);
+
+		auto& Handle = Handles.Emplace_GetRef(Classes[ClassIndex], RelativeTransform * BaseTransform);
+		
+		if (BuildableIndex != INDEX_NONE)
+		{
+			Handle.Buildable = Buildables[BuildableIndex];
+		}
+	}
+
+	OutHandles = MoveTemp(Handles);
+	return true;
+}
+
+FIntVector FAutoSupportHandleCodec::QuantizeOffset(const FVector& Offset)
+{
+	FIntVector QuantizedOffset;
+	
+	for (auto Axis = 0; Axis < 3; ++Axis)
+	{
+		const auto Quantized = FMath::RoundToDouble(Offset[Axis] / OffsetQuantum);
+		QuantizedOffset[Axis] = static_cast<int32>(FMath::Clamp(Quantized, static_cast<double>(MIN_int32), static_cast<double>(MAX_int32)));
+	}
+
+	return QuantizedOffset;
+}
+
+FVector FAutoSupportHandleCodec::DequantizeOffset(const FIntVector& QuantizedOffset)
+{
+	return FVector(QuantizedOffset.X, QuantizedOffset.Y, QuantizedOffset.Z) * OffsetQuantum;
+}
+
+void FAutoSupportHandleCodec::SerializeSigned(FArchive& Ar, int32& Value)
+{
+	// Zigzag so small negative values pack small too.
+	uint32 Encoded = Ar.IsSaving() ? (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31) : 0;
+	
+	Ar.SerializeIntPacked(Encoded);
+
+	if (Ar.IsLoading())
+	{
+		Value = static_cast<int32>(Encoded >> 1) ^ -static_cast<int32>(Encoded & 1);
+	}
+}
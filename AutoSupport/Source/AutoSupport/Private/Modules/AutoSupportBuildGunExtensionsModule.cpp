@@ -4,11 +4,19 @@
 
 #include "AutoSupportGameInstanceModule.h"
 #include "AutoSupportModLocalPlayerSubsystem.h"
+#include "AutoSupportModSubsystem.h"
+#include "AutoSupportRemoteCallObject.h"
+#include "BuildableAutoSupport.h"
+#include "BuildableAutoSupportProxy.h"
+#include "BuildableAutoSupportProxyCollision.h"
+#include "BuildableAutoSupportRegion.h"
 #include "FGBuildGun.h"
+#include "FGBuildGunBuild.h"
 #include "FGBuildGunDismantle.h"
 #include "FGCharacterPlayer.h"
 #include "ModConstants.h"
 #include "ModLogging.h"
+#include "Components/InstancedStaticMeshComponent.h"
 
 UAutoSupportBuildGunExtensionsModule* UAutoSupportBuildGunExtensionsModule::Get(const UWorld* World)
 {
@@ -52,6 +60,11 @@ void UAutoSupportBuildGunExtensionsModule::OnBuildGunEndPlay(AFGBuildGun* BuildG
 	MOD_LOG(Verbose, TEXT("Invoked. Instance: [%s], Reason: [%i]"), TEXT_STR(BuildGun->GetName()), static_cast<int32>(Reason))
 
 	HookedBuildGuns.Remove(BuildGun);
+
+	if (auto* Player = Cast<AFGCharacterPlayer>(BuildGun->GetInstigator()))
+	{
+		SetBuildGunHoveredCube(Player, nullptr);
+	}
 	
 	if (Reason == EEndPlayReason::Type::Destroyed)
 	{
@@ -80,13 +93,343 @@ void UAutoSupportBuildGunExtensionsModule::AppendExtraDismantleModes(TArray<TSub
 	{
 		MOD_LOG(Warning, TEXT("No ProxyDismantleMode was set."))
 	}
+
+	if (ProxyAreaDismantleMode)
+	{
+		OutExtraModes.Add(ProxyAreaDismantleMode);
+	}
+}
+
+void UAutoSupportBuildGunExtensionsModule::OnBuildGunDismantleStateTick(UFGBuildGunStateDismantle* State)
+{
+	if (ProxyAreaDismantleMode && IsValid(State) && State->IsCurrentBuildGunMode(ProxyAreaDismantleMode))
+	{
+		TickAreaDismantle(State);
+		return;
+	}
+
+	if (auto* Player = GetDismantlingPlayer(State); Player && AreaDismantleSelections.Contains(Player))
+	{
+		ClearAreaDismantleSelection(Player);
+	}
+	
+	if (!ProxyDismantleMode || !IsValid(State) || !State->mCurrentlyAimedAtActor || !State->IsCurrentBuildGunMode(ProxyDismantleMode))
+	{
+		return;
+	}
+
+	auto* AimedAtActor = State->mCurrentlyAimedAtActor;
+
+	if (AimedAtActor->IsA<ABuildableAutoSupportProxy>())
+	{
+		return;
+	}
+
+	if (auto* AimedAtRegion = Cast<ABuildableAutoSupportRegion>(AimedAtActor))
+	{
+		TickRegionDismantle(State, AimedAtRegion);
+		return;
+	}
+
+	if (const auto* AimedAtCollision = Cast<ABuildableAutoSupportProxyCollision>(AimedAtActor))
+	{
+		State->SetAimedAtActor(TraceProxyCollision(State, AimedAtCollision));
+		return;
+	}
+
+	// Single part supports have no proxy and are the buildable itself.
+	if (auto* AimedAtBuildable = Cast<AFGBuildable>(AimedAtActor))
+	{
+		if (const auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld()); SupportSubsys && SupportSubsys->IsSinglePartSupport(AimedAtBuildable))
+		{
+			return;
+		}
+	}
+	
+	// Prevents anything other than the support actors from being a candidate for dismantle
+	State->SetAimedAtActor(nullptr);
 }
 
-void UAutoSupportBuildGunExtensionsModule::OnBuildGunDismantleStateTick(UFGBuildGunStateDismantle* State) const
+void UAutoSupportBuildGunExtensionsModule::OnBuildGunBuildStateTick(UFGBuildGunStateBuild* State)
 {
-	if (ProxyDismantleMode && IsValid(State) && State->mCurrentlyAimedAtActor && State->IsCurrentBuildGunMode(ProxyDismantleMode) && !State->mCurrentlyAimedAtActor->IsA<ABuildableAutoSupportProxy>())
+	auto* Player = GetBuildGunPlayer(State);
+
+	// The preview is only drawn for the local player.
+	if (!Player || !Player->IsLocallyControlled())
+	{
+		return;
+	}
+
+	const auto* Controller = Cast<APlayerController>(Player->GetController());
+
+	if (!Controller)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	FHitResult Hit;
+	const FCollisionQueryParams QueryParams(TEXT("AutoSupportBuildPreviewHover"), false, Player);
+	const auto ViewEnd = ViewLocation + ViewRotation.Vector() * BuildPreviewHoverDistance;
+	
+	auto* Cube = GetWorld()->LineTraceSingleByChannel(Hit, ViewLocation, ViewEnd, ECC_Visibility, QueryParams)
+		? Cast<ABuildableAutoSupport>(Hit.GetActor())
+		: nullptr;
+
+	SetBuildGunHoveredCube(Player, Cube);
+}
+
+void UAutoSupportBuildGunExtensionsModule::OnBuildGunBuildStateEnd(UFGBuildGunStateBuild* State)
+{
+	if (auto* Player = GetBuildGunPlayer(State))
+	{
+		SetBuildGunHoveredCube(Player, nullptr);
+	}
+}
+
+void UAutoSupportBuildGunExtensionsModule::SetBuildGunHoveredCube(AFGCharacterPlayer* Player, ABuildableAutoSupport* Cube)
+{
+	auto* HoveredCube = BuildGunHoveredCubes.Find(Player);
+	auto* PreviousCube = HoveredCube ? HoveredCube->Get() : nullptr;
+
+	if (PreviousCube == Cube)
+	{
+		return;
+	}
+
+	if (PreviousCube)
+	{
+		PreviousCube->RemoveBuildPreviewRequest();
+	}
+
+	if (Cube)
+	{
+		Cube->AddBuildPreviewRequest(Player);
+		BuildGunHoveredCubes.Add(Player, Cube);
+	}
+	else
+	{
+		BuildGunHoveredCubes.Remove(Player);
+	}
+}
+
+bool UAutoSupportBuildGunExtensionsModule::OnBuildGunDismantlePrimaryFire(UFGBuildGunStateDismantle* State)
+{
+	if (ProxyDismantleMode && IsValid(State) && State->IsCurrentBuildGunMode(ProxyDismantleMode))
+	{
+		auto* AimedAtRegion = Cast<ABuildableAutoSupportRegion>(State->mCurrentlyAimedAtActor);
+		return AimedAtRegion && DismantleAimedRegionRecord(State, AimedAtRegion);
+	}
+	
+	if (!ProxyAreaDismantleMode || !IsValid(State) || !State->IsCurrentBuildGunMode(ProxyAreaDismantleMode))
+	{
+		return false;
+	}
+
+	auto* Player = GetDismantlingPlayer(State);
+	
+	if (!Player || !Player->HasAuthority())
+	{
+		MOD_LOG(Warning, TEXT("Area dismantle is only supported with authority."))
+		return true;
+	}
+
+	TArray<ABuildableAutoSupportProxy*> Proxies;
+
+	if (const auto* Selection = AreaDismantleSelections.Find(Player))
+	{
+		for (const auto& Proxy : Selection->Proxies)
+		{
+			if (Proxy.IsValid())
+			{
+				Proxies.Add(Proxy.Get());
+			}
+		}
+	}
+
+	ClearAreaDismantleSelection(Player);
+
+	if (auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld()); SupportSubsys && !Proxies.IsEmpty())
+	{
+		SupportSubsys->DismantleProxies(Proxies, Player);
+	}
+
+	return true;
+}
+
+bool UAutoSupportBuildGunExtensionsModule::DismantleAimedRegionRecord(UFGBuildGunStateDismantle* State, ABuildableAutoSupportRegion* Region)
+{
+	auto* Player = GetDismantlingPlayer(State);
+	const auto RecordId = Region->GetAimedRecord(Player);
+
+	// Handled either way, the vanilla dismantle can't tell which record is meant.
+	if (RecordId == INDEX_NONE)
+	{
+		return true;
+	}
+
+	// The record the player sees highlighted is the one sent, the server does not trace again.
+	if (auto* RemoteCallObject = UAutoSupportRemoteCallObject::Get(Player))
+	{
+		RemoteCallObject->Server_DismantleRegionRecord(Region, RecordId);
+	}
+	else
+	{
+		MOD_LOG(Warning, TEXT("No remote call object for player [%s]. Can't dismantle the region record."), TEXT_ACTOR_NAME(Player))
+	}
+
+	return true;
+}
+
+void UAutoSupportBuildGunExtensionsModule::TickAreaDismantle(UFGBuildGunStateDismantle* State)
+{
+	// The area is ours to select, nothing is aimed at individually.
+	State->SetAimedAtActor(nullptr);
+
+	auto* Player = GetDismantlingPlayer(State);
+	const auto* Controller = Player ? Cast<APlayerController>(Player->GetController()) : nullptr;
+	const auto* SupportSubsys = AAutoSupportModSubsystem::Get(GetWorld());
+
+	if (!Controller || !SupportSubsys)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const auto TraceEnd = ViewLocation + ViewRotation.Vector() * AreaDismantleTraceDistance;
+	FHitResult Hit;
+	FCollisionQueryParams QueryParams(TEXT("AutoSupportAreaDismantle"), false, Player);
+	
+	const auto AreaCenter = GetWorld()->LineTraceSingleByChannel(Hit, ViewLocation, TraceEnd, ECC_Visibility, QueryParams)
+		? Hit.ImpactPoint
+		: TraceEnd;
+
+	TArray<ABuildableAutoSupportProxy*> Proxies;
+
+	if (AreaDismantleShape == EAutoSupportAreaDismantleShape::Box)
+	{
+		SupportSubsys->GetProxiesInBox(FBox(AreaCenter - AreaDismantleExtent, AreaCenter + AreaDismantleExtent), Proxies);
+	}
+	else
+	{
+		SupportSubsys->GetProxiesInRadius(AreaCenter, AreaDismantleRadius, Proxies);
+	}
+
+	// Only what the batch will dismantle is highlighted.
+	TArray<ABuildableAutoSupportProxy*> DismantleableProxies;
+	AAutoSupportModSubsystem::FilterDismantleableProxies(Proxies, DismantleableProxies);
+
+	UpdateAreaDismantleSelection(DismantleableProxies, Player);
+}
+
+void UAutoSupportBuildGunExtensionsModule::TickRegionDismantle(UFGBuildGunStateDismantle* State, ABuildableAutoSupportRegion* Region)
+{
+	auto* Player = GetDismantlingPlayer(State);
+	const auto* Controller = Player ? Cast<APlayerController>(Player->GetController()) : nullptr;
+
+	if (!Controller)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	// The record highlighted is the record sent to the server when fired, see DismantleAimedRegionRecord.
+	const auto RecordId = Region->TraceRecord(ViewLocation, ViewLocation + ViewRotation.Vector() * AreaDismantleTraceDistance);
+	Region->SetAimedRecord(RecordId, Player);
+
+	if (RecordId == INDEX_NONE)
 	{
-		// Prevents anything other than the proxies actors from being a candidate for dismantle
 		State->SetAimedAtActor(nullptr);
 	}
 }
+
+ABuildableAutoSupportProxy* UAutoSupportBuildGunExtensionsModule::TraceProxyCollision(
+	const UFGBuildGunStateDismantle* State,
+	const ABuildableAutoSupportProxyCollision* Collision) const
+{
+	auto* Player = GetDismantlingPlayer(State);
+	const auto* Controller = Player ? Cast<APlayerController>(Player->GetController()) : nullptr;
+
+	if (!Controller)
+	{
+		return nullptr;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	// The instance hit is the proxy.
+	FHitResult Hit;
+	const FCollisionQueryParams QueryParams(TEXT("AutoSupportProxyCollision"), false, Player);
+	const auto ViewEnd = ViewLocation + ViewRotation.Vector() * AreaDismantleTraceDistance;
+	
+	return Collision->GetInstanceCollisionComponent()->LineTraceComponent(Hit, ViewLocation, ViewEnd, QueryParams)
+		? Collision->FindProxyByInstance(Hit.Item)
+		: nullptr;
+}
+
+void UAutoSupportBuildGunExtensionsModule::UpdateAreaDismantleSelection(const TArray<ABuildableAutoSupportProxy*>& Proxies, AFGCharacterPlayer* Player)
+{
+	// Only highlight changes are applied, the area moves a little every frame.
+	TSet<ABuildableAutoSupportProxy*> NewSelection(Proxies);
+	auto& Selection = AreaDismantleSelections.FindOrAdd(Player).Proxies;
+	
+	for (const auto& Proxy : Selection)
+	{
+		if (Proxy.IsValid() && !NewSelection.Remove(Proxy.Get()))
+		{
+			Proxy->HideDismantleHighlight(Player);
+		}
+	}
+
+	for (auto* Proxy : NewSelection)
+	{
+		Proxy->ShowDismantleHighlight(Player);
+	}
+
+	Selection.Reset(Proxies.Num());
+	
+	for (auto* Proxy : Proxies)
+	{
+		Selection.Add(Proxy);
+	}
+}
+
+void UAutoSupportBuildGunExtensionsModule::ClearAreaDismantleSelection(AFGCharacterPlayer* Player)
+{
+	FAutoSupportAreaDismantleSelection Selection;
+	
+	if (!AreaDismantleSelections.RemoveAndCopyValue(Player, Selection))
+	{
+		return;
+	}
+	
+	for (const auto& Proxy : Selection.Proxies)
+	{
+		if (Proxy.IsValid())
+		{
+			Proxy->HideDismantleHighlight(Player);
+		}
+	}
+}
+
+AFGCharacterPlayer* UAutoSupportBuildGunExtensionsModule::GetDismantlingPlayer(const UFGBuildGunStateDismantle* State)
+{
+	return GetBuildGunPlayer(State);
+}
+
+AFGCharacterPlayer* UAutoSupportBuildGunExtensionsModule::GetBuildGunPlayer(const UFGBuildGunState* State)
+{
+	const auto* BuildGun = IsValid(State) ? State->GetBuildGun() : nullptr;
+	return BuildGun ? Cast<AFGCharacterPlayer>(BuildGun->GetInstigator()) : nullptr;
+}
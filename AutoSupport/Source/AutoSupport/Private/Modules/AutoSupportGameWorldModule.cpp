@@ -2,6 +2,7 @@
 
 #include "AutoSupportGameWorldModule.h"
 
+#include "AutoSupportRemoteCallObject.h"
 #include "ModConstants.h"
 #include "WorldModuleManager.h"
 
@@ -11,3 +12,13 @@ UAutoSupportGameWorldModule* UAutoSupportGameWorldModule::GetRoot(const UWorld*
 	return CastChecked<UAutoSupportGameWorldModule>(WorldModuleManager->FindModule(AutoSupportConstants::ModReference));
 }
 
+void UAutoSupportGameWorldModule::DispatchLifecycleEvent(ELifecyclePhase Phase)
+{
+	// Registered from code so the blueprint of the root module can't miss it. Before the base class registers the default content.
+	if (Phase == ELifecyclePhase::CONSTRUCTION && bRootModule)
+	{
+		RemoteCallObjects.AddUnique(UAutoSupportRemoteCallObject::StaticClass());
+	}
+	
+	Super::DispatchLifecycleEvent(Phase);
+}
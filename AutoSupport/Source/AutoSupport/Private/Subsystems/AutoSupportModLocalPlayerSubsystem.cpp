@@ -6,9 +6,11 @@
 #include "AutoSupportBuildGunInputMappingContext.h"
 #include "AutoSupportModSubsystem.h"
 #include "BuildableAutoSupportProxy.h"
+#include "BuildableAutoSupportRegion.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "FGPlayerController.h"
+#include "ModDefines.h"
 #include "ModLogging.h"
 #include "Kismet/GameplayStatics.h"
 
@@ -74,6 +76,11 @@ void UAutoSupportModLocalPlayerSubsystem::OnBuildGunStateChanged(EBuildGunState
 	if (NewState != EBuildGunState::BGS_DISMANTLE) // clean up for non-dismantle
 	{
 		AsyncUpdateAllProxiesBuildMode(nullptr);
+
+		if (auto* BuildGunExtensions = UAutoSupportBuildGunExtensionsModule::Get(GetWorld()))
+		{
+			BuildGunExtensions->ClearAreaDismantleSelection(GetPlayerCharacter());
+		}
 	}
 
 	if (NewState == EBuildGunState::BGS_BUILD)
@@ -104,6 +111,12 @@ void UAutoSupportModLocalPlayerSubsystem::SyncProxyWithBuildGunState(ABuildableA
 	Proxy->OnBuildModeUpdate(CurrentBuildModeClass, GetLocalPlayer());
 }
 
+void UAutoSupportModLocalPlayerSubsystem::SyncRegionWithBuildGunState(ABuildableAutoSupportRegion* Region) const
+{
+	const auto* BuildGun = GetBuildGun();
+	Region->OnBuildModeUpdate(BuildGun ? BuildGun->GetCurrentBuildGunMode() : nullptr);
+}
+
 void UAutoSupportModLocalPlayerSubsystem::PlayerControllerChanged(APlayerController* NewPlayerController)
 {
 	MOD_LOG(Verbose, TEXT("Player controller changed to [%s]"), TEXT_CLS_NAME(NewPlayerController))
@@ -188,19 +201,25 @@ void UAutoSupportModLocalPlayerSubsystem::OnAutoBuildSupportsKeyCompleted()
 	IsAutoBuildKeyHeld = false;
 }
 
-void UAutoSupportModLocalPlayerSubsystem::AsyncUpdateAllProxiesBuildMode(TSubclassOf<UFGBuildGunModeDescriptor> ModeDescriptor) const
+void UAutoSupportModLocalPlayerSubsystem::AsyncUpdateAllProxiesBuildMode(TSubclassOf<UFGBuildGunModeDescriptor> ModeDescriptor)
 {
 	MOD_LOG(Verbose, TEXT("Invoked"))
-	AsyncTask(ENamedThreads::GameThread, [this, ModeDescriptor]
+	AsyncTask(ENamedThreads::GameThread, [WeakThis = TWeakObjectPtr<UAutoSupportModLocalPlayerSubsystem>(this), ModeDescriptor]
 	{
-		const auto* World = GetWorld();
+		auto* This = WeakThis.Get();
+		if (!This)
+		{
+			return;
+		}
+		
+		const auto* World = This->GetWorld();
 		if (!IsValid(World))
 		{
 			MOD_LOG(Warning, TEXT("World not valid. Skipping."))
 			return;
 		}
 		
-		auto* LocalPlayer = GetLocalPlayer();	
+		auto* LocalPlayer = This->GetLocalPlayer();	
 		if (!IsValid(LocalPlayer))
 		{
 			MOD_LOG(Warning, TEXT("Local player not valid. Skipping..."))
@@ -209,27 +228,121 @@ void UAutoSupportModLocalPlayerSubsystem::AsyncUpdateAllProxiesBuildMode(TSubcla
 
 		auto* AutoSupportSubsys = AAutoSupportModSubsystem::Get(World);
 		fgcheck(AutoSupportSubsys)
+
+		// A newer mode replaces whatever is still queued.
+		World->GetTimerManager().ClearTimer(This->BuildModeUpdateTimerHandle);
+		This->PendingBuildMode = ModeDescriptor;
+		This->PendingBuildModeUpdates.Reset();
+
+		FVector ViewLocation = FVector::ZeroVector;
+		FRotator ViewRotation;
 		
-		auto ProxyCount = AutoSupportSubsys->AllProxies.Num();
-		MOD_LOG(Verbose, TEXT("Updating all (%i) proxies with build mode [%s]"), ProxyCount, TEXT_CLS_NAME(ModeDescriptor))
+		if (const auto* Controller = LocalPlayer->GetPlayerController(World))
+		{
+			Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		}
+
+		// Nearby proxies are what the player is looking at, update those now.
+		TArray<ABuildableAutoSupportProxy*> NearProxies;
+		AutoSupportSubsys->GetProxiesInRadius(ViewLocation, AUTOSUPPORT_BUILD_MODE_IMMEDIATE_UPDATE_RADIUS, NearProxies);
+
+		auto NumUpdated = 0;
+
+		TArray<ABuildableAutoSupportRegion*> Regions;
+		AutoSupportSubsys->GetRegions(Regions);
+
+		for (auto* Region : Regions)
+		{
+			Region->OnBuildModeUpdate(ModeDescriptor);
+		}
+
+		// The shared proxy collision is a body per cell, toggled right away.
+		const auto* BuildGunExtensions = UAutoSupportBuildGunExtensionsModule::Get(World);
+		const auto bIsProxyDismantleMode = ModeDescriptor && BuildGunExtensions && ModeDescriptor == BuildGunExtensions->ProxyDismantleMode;
+		AutoSupportSubsys->SetProxyDismantleModeActive(LocalPlayer, bIsProxyDismantleMode);
 		
-		for (const auto& Proxy : AutoSupportSubsys->AllProxies)
+		for (auto* Proxy : NearProxies)
 		{
-			if (Proxy.IsValid())
+			if (!Proxy->IsInBuildMode(ModeDescriptor))
 			{
 				Proxy->OnBuildModeUpdate(ModeDescriptor, LocalPlayer);
+				++NumUpdated;
 			}
-			else
+		}
+
+		// Queue the rest, farthest first so the nearest pop off the end first.
+		TArray<TPair<double, ABuildableAutoSupportProxy*>> FarProxies;
+		
+		for (const auto& Proxy : AutoSupportSubsys->AllProxies)
+		{
+			if (Proxy.IsValid() && !Proxy->IsInBuildMode(ModeDescriptor))
 			{
-				MOD_LOG(Warning, TEXT("Proxy is invalid... skipping"))
+				FarProxies.Emplace(FVector::DistSquared(ViewLocation, Proxy->GetActorLocation()), Proxy.Get());
 			}
 		}
+
+		FarProxies.Sort([](const TPair<double, ABuildableAutoSupportProxy*>& A, const TPair<double, ABuildableAutoSupportProxy*>& B)
+		{
+			return A.Key > B.Key;
+		});
+
+		This->PendingBuildModeUpdates.Reserve(FarProxies.Num());
+		
+		for (const auto& FarProxy : FarProxies)
+		{
+			This->PendingBuildModeUpdates.Add(FarProxy.Value);
+		}
 		
-		ProxyCount = AutoSupportSubsys->AllProxies.Num();
-		MOD_LOG(Verbose, TEXT("Finished updating all (%i) proxies with build mode [%s]"), ProxyCount, TEXT_CLS_NAME(ModeDescriptor))
+		MOD_LOG(
+			Verbose,
+			TEXT("Updated %i nearby proxies and queued %i of %i proxies with build mode [%s]"),
+			NumUpdated,
+			This->PendingBuildModeUpdates.Num(),
+			AutoSupportSubsys->AllProxies.Num(),
+			TEXT_CLS_NAME(ModeDescriptor))
+
+		if (!This->PendingBuildModeUpdates.IsEmpty())
+		{
+			This->ProcessPendingBuildModeUpdates();
+		}
 	});
 }
 
+void UAutoSupportModLocalPlayerSubsystem::ProcessPendingBuildModeUpdates()
+{
+	auto* LocalPlayer = GetLocalPlayer();
+	auto* World = GetWorld();
+	
+	if (!IsValid(LocalPlayer) || !IsValid(World))
+	{
+		PendingBuildModeUpdates.Reset();
+		return;
+	}
+
+	for (auto Budget = AUTOSUPPORT_BUILD_MODE_UPDATES_PER_FRAME; Budget > 0 && !PendingBuildModeUpdates.IsEmpty();)
+	{
+		const auto Proxy = PendingBuildModeUpdates.Pop(false);
+
+		// Already updated by a register sync or destroyed since being queued. Doesn't cost budget.
+		if (!Proxy.IsValid() || Proxy->IsInBuildMode(PendingBuildMode))
+		{
+			continue;
+		}
+
+		Proxy->OnBuildModeUpdate(PendingBuildMode, LocalPlayer);
+		--Budget;
+	}
+
+	if (PendingBuildModeUpdates.IsEmpty())
+	{
+		MOD_LOG(Verbose, TEXT("Finished updating proxies with build mode [%s]"), TEXT_CLS_NAME(PendingBuildMode))
+		return;
+	}
+
+	BuildModeUpdateTimerHandle = World->GetTimerManager().SetTimerForNextTick(
+		FTimerDelegate::CreateUObject(this, &UAutoSupportModLocalPlayerSubsystem::ProcessPendingBuildModeUpdates));
+}
+
 bool UAutoSupportModLocalPlayerSubsystem::IsHoldingAutoBuildKey() const
 {
 	return IsAutoBuildKeyHeld;
@@ -5,20 +5,96 @@
 #include "AutoSupportGameWorldModule.h"
 #include "AutoSupportModLocalPlayerSubsystem.h"
 #include "BuildableAutoSupportProxy.h"
+#include "BuildableAutoSupportProxyCollision.h"
+#include "BuildableAutoSupportRegion.h"
+#include "FGBuildingDescriptor.h"
+#include "FGCharacterPlayer.h"
+#include "FGCrate.h"
+#include "FGInventoryComponent.h"
+#include "FGItemPickup_Spawnable.h"
+#include "FGLightweightBuildableSubsystem.h"
+#include "FGRecipe.h"
+#include "FGRecipeManager.h"
 #include "ModConstants.h"
+#include "ModDefines.h"
 #include "ModLogging.h"
 #include "WorldModuleManager.h"
+#include "Engine/AssetManager.h"
 #include "Subsystem/SubsystemActorManager.h"
 
 TMap<TWeakObjectPtr<const UWorld>, TWeakObjectPtr<AAutoSupportModSubsystem>> AAutoSupportModSubsystem::CachedSubsystemLookup;
 FCriticalSection AAutoSupportModSubsystem::CachedSubsystemLookupLock;
+std::atomic<uint32> AAutoSupportModSubsystem::FastPathSequence { 0 };
+std::atomic<const UWorld*> AAutoSupportModSubsystem::FastPathWorld { nullptr };
+std::atomic<int32> AAutoSupportModSubsystem::FastPathWorldSerial { 0 };
+std::atomic<AAutoSupportModSubsystem*> AAutoSupportModSubsystem::FastPathSubsystem { nullptr };
+
+static FAutoConsoleCommandWithWorldAndArgs CmdBenchHandleLookup(
+	TEXT("AutoSupport.BenchHandleLookup"),
+	TEXT("Times lookups of buildable handles in the proxy by buildable map. Usage: AutoSupport.BenchHandleLookup [Iterations=100]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto* Subsystem = AAutoSupportModSubsystem::Get(World))
+		{
+			Subsystem->BenchmarkHandleLookups(Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdMemReport(
+	TEXT("AutoSupport.MemReport"),
+	TEXT("Prints the memory used by the support proxy parts, in bytes per part."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const auto* Subsystem = AAutoSupportModSubsystem::Get(World))
+		{
+			Subsystem->LogHandleMemoryReport();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdAudit(
+	TEXT("AutoSupport.Audit"),
+	TEXT("Prints the last audit of the support handles and starts a new one, whose summary is printed when done."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (auto* Subsystem = AAutoSupportModSubsystem::Get(World))
+		{
+			Subsystem->LogLastAuditSummary();
+			Subsystem->StartAudit(true);
+		}
+	}));
+
+AAutoSupportModSubsystem::AAutoSupportModSubsystem()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+}
 
 AAutoSupportModSubsystem* AAutoSupportModSubsystem::Get(const UWorld* World)
 {
+	// Fast path for the common single world case, no lock taken.
+	if (const auto SequenceBefore = FastPathSequence.load(std::memory_order_acquire); (SequenceBefore & 1) == 0)
+	{
+		const auto* CachedWorld = FastPathWorld.load(std::memory_order_relaxed);
+		const auto CachedWorldSerial = FastPathWorldSerial.load(std::memory_order_relaxed);
+		auto* CachedSubsystem = FastPathSubsystem.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		
+		if (FastPathSequence.load(std::memory_order_relaxed) == SequenceBefore
+			&& CachedWorld == World
+			&& CachedSubsystem
+			&& World
+			&& GUObjectArray.GetSerialNumber(GUObjectArray.ObjectToIndex(World)) == CachedWorldSerial)
+		{
+			return CachedSubsystem;
+		}
+	}
+	
 	{
 		FScopeLock Lock(&CachedSubsystemLookupLock);
 		if (const auto* CachedEntry = CachedSubsystemLookup.Find(World); CachedEntry && CachedEntry->IsValid())
 		{
+			PublishFastPath(World, CachedEntry->Get());
 			return CachedEntry->Get();
 		}
 	}
@@ -57,11 +133,55 @@ AAutoSupportModSubsystem* AAutoSupportModSubsystem::Get(const UWorld* World)
 	{
 		FScopeLock Lock(&CachedSubsystemLookupLock);
 		CachedSubsystemLookup.Add(World, Result);
+
+		if (Result)
+		{
+			PublishFastPath(World, Result);
+		}
 	}
 	
 	return Result;
 }
 
+void AAutoSupportModSubsystem::PublishFastPath(const UWorld* World, AAutoSupportModSubsystem* Subsystem)
+{
+	// Allocated like a weak pointer would. A freed world's index gets serial 0 or a new serial once reused, so it never matches again.
+	const auto WorldSerial = World ? GUObjectArray.AllocateSerialNumber(GUObjectArray.ObjectToIndex(World)) : 0;
+	
+	if (FastPathWorld.load(std::memory_order_relaxed) == World
+		&& FastPathWorldSerial.load(std::memory_order_relaxed) == WorldSerial
+		&& FastPathSubsystem.load(std::memory_order_relaxed) == Subsystem)
+	{
+		return;
+	}
+	
+	FastPathSequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FastPathWorld.store(World, std::memory_order_relaxed);
+	FastPathWorldSerial.store(WorldSerial, std::memory_order_relaxed);
+	FastPathSubsystem.store(Subsystem, std::memory_order_relaxed);
+
+	FastPathSequence.fetch_add(1, std::memory_order_release);
+}
+
+void AAutoSupportModSubsystem::ClearFastPath(const UWorld* World)
+{
+	if (FastPathWorld.load(std::memory_order_relaxed) != World)
+	{
+		return;
+	}
+	
+	FastPathSequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FastPathWorld.store(nullptr, std::memory_order_relaxed);
+	FastPathWorldSerial.store(0, std::memory_order_relaxed);
+	FastPathSubsystem.store(nullptr, std::memory_order_relaxed);
+
+	FastPathSequence.fetch_add(1, std::memory_order_release);
+}
+
 void AAutoSupportModSubsystem::Init()
 {
 	Super::Init();
@@ -71,7 +191,10 @@ void AAutoSupportModSubsystem::Init()
 	{
 		FScopeLock Lock(&CachedSubsystemLookupLock);
 		CachedSubsystemLookup.Add(World, this);
+		PublishFastPath(World, this);
 	}
+
+	RebuildRemovalFilter();
 	
 	auto* Buildables = AFGBuildableSubsystem::Get(World);
 	Buildables->mBuildableRemovedDelegate.AddDynamic(this, &AAutoSupportModSubsystem::OnWorldBuildableRemoved);
@@ -79,56 +202,1586 @@ void AAutoSupportModSubsystem::Init()
 	MOD_LOG(Verbose, TEXT("Added AFGBuildableSubsystem delegates"))
 }
 
-void AAutoSupportModSubsystem::OnWorldBuildableRemoved(AFGBuildable* Buildable)
+void AAutoSupportModSubsystem::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	const FAutoSupportBuildableHandle Handle(Buildable);
-	const auto* ProxyEntry = ProxyByBuildable.Find(Handle);
+	{
+		// Nothing may find this subsystem once the world tears down, the fast path holds a raw pointer.
+		FScopeLock Lock(&CachedSubsystemLookupLock);
+		CachedSubsystemLookup.Remove(GetWorld());
+		ClearFastPath(GetWorld());
+	}
+	
+	Super::EndPlay(EndPlayReason);
+}
 
-	if (!ProxyEntry || !ProxyEntry->IsValid())
+void AAutoSupportModSubsystem::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!PendingLightweightResolves.IsEmpty())
+	{
+		ResolvePendingLightweights();
+	}
+
+	if (!PendingDismantleCommits.IsEmpty())
+	{
+		CommitPendingDismantles();
+	}
+
+	TickCompaction();
+	TickAudit();
+	BroadcastProxyEvents();
+}
+
+void AAutoSupportModSubsystem::BroadcastProxyEvents()
+{
+	// Each batch is taken before it's broadcast, events caused by subscribers go out with the next tick.
+	if (!PendingRegisteredEvents.IsEmpty())
+	{
+		TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> Proxies;
+		Proxies.Reserve(PendingRegisteredEvents.Num());
+
+		for (const auto& Proxy : PendingRegisteredEvents)
+		{
+			if (Proxy.IsValid())
+			{
+				Proxies.Add(Proxy);
+			}
+		}
+
+		PendingRegisteredEvents.Reset();
+		
+		if (!Proxies.IsEmpty())
+		{
+			OnProxiesRegistered.Broadcast(Proxies);
+		}
+	}
+
+	if (!PendingPartsRemovedEvents.IsEmpty())
+	{
+		TArray<FAutoSupportProxyRemovedParts> RemovedParts;
+		RemovedParts.Reserve(PendingPartsRemovedEvents.Num());
+
+		for (auto& Entry : PendingPartsRemovedEvents)
+		{
+			RemovedParts.Add({ Entry.Key, MoveTemp(Entry.Value) });
+		}
+
+		PendingPartsRemovedEvents.Reset();
+		OnProxyPartsRemoved.Broadcast(RemovedParts);
+	}
+
+	if (!PendingLoadResolvedEvents.IsEmpty())
+	{
+		const auto Proxies = MoveTemp(PendingLoadResolvedEvents);
+		PendingLoadResolvedEvents.Reset();
+		OnProxiesLoadResolved.Broadcast(Proxies);
+	}
+
+	if (!PendingDestroyedEvents.IsEmpty())
+	{
+		const auto Proxies = MoveTemp(PendingDestroyedEvents);
+		PendingDestroyedEvents.Reset();
+		OnProxiesDestroyed.Broadcast(Proxies);
+	}
+}
+
+void AAutoSupportModSubsystem::StartAudit(const bool bLogSummary)
+{
+	bLogAuditSummary |= bLogSummary;
+	
+	if (!AuditQueue.IsEmpty())
 	{
 		return;
 	}
+
+	// Every registered handle, wherever it is registered. AuditHandle finds which from the handle.
+	ProxyByBuildable.GenerateKeyArray(AuditQueue);
+	AuditQueue.Reserve(AuditQueue.Num() + SinglePartSupports.Num() + RegionRecordByBuildable.Num());
+	AuditQueue.Append(SinglePartSupports.Array());
+
+	for (const auto& Entry : RegionRecordByBuildable)
+	{
+		AuditQueue.Add(Entry.Key);
+	}
 	
-	MOD_LOG(Verbose, TEXT("Found proxy. Removing handle and unregistering buildable."))
-	const auto Removed = ProxyByBuildable.Remove(Handle);
-	fgcheck(Removed == 1) // Check the equality contract is working as intended.
-	auto* Proxy = ProxyEntry->Get();
-	Proxy->UnregisterBuildable(Buildable);
+	AuditInstanceIndex.Reset();
+	AuditStats = FAutoSupportAuditStats();
+	AuditStats.StartTime = GetWorld()->GetTimeSeconds();
+
+	MOD_LOG(Verbose, TEXT("Started an audit of %i handles."), AuditQueue.Num())
+
+	if (AuditQueue.IsEmpty())
+	{
+		FinishAudit();
+	}
 }
 
-void AAutoSupportModSubsystem::OnProxyDestroyed(const ABuildableAutoSupportProxy* Proxy)
+void AAutoSupportModSubsystem::TickAudit()
 {
-	MOD_LOG(Verbose, TEXT("Invoked"))
+	if (AuditQueue.IsEmpty())
+	{
+		const auto LastAuditTime = bHasCompletedAudit ? LastAuditStats.EndTime : 0;
+		
+		if (GetWorld()->GetTimeSeconds() - LastAuditTime < AUTOSUPPORT_AUDIT_INTERVAL || !PendingLightweightResolves.IsEmpty())
+		{
+			return;
+		}
+
+		StartAudit(false);
+	}
+
+	for (auto Budget = AUTOSUPPORT_AUDIT_HANDLES_PER_FRAME; Budget > 0 && !AuditQueue.IsEmpty(); --Budget)
+	{
+		AuditHandle(AuditQueue.Pop(false));
+	}
+
+	if (AuditQueue.IsEmpty())
+	{
+		FinishAudit();
+	}
+}
+
+void AAutoSupportModSubsystem::AuditHandle(const FAutoSupportBuildableHandle& Handle)
+{
+	if (const auto* ProxyEntry = ProxyByBuildable.Find(Handle))
+	{
+		AuditProxyHandle(Handle, *ProxyEntry);
+	}
+	else if (const auto* RecordRef = RegionRecordByBuildable.Find(Handle))
+	{
+		AuditRegionHandle(Handle, *RecordRef);
+	}
+	else if (SinglePartSupports.Contains(Handle))
+	{
+		++AuditStats.NumHandlesChecked;
+		AuditUnreferencedHandle(Handle);
+	}
+
+	// Otherwise unlinked since the audit started.
+}
+
+void AAutoSupportModSubsystem::AuditRegionHandle(const FAutoSupportBuildableHandle& Handle, const FAutoSupportRegionRecordRef& RecordRef)
+{
+	++AuditStats.NumHandlesChecked;
+
+	const auto* Region = RecordRef.Region.Get();
+	
+	if (!IsValid(Region) || !Region->FindRecord(RecordRef.RecordId))
+	{
+		MOD_LOG(Warning, TEXT("Audit: removing link to a destroyed region record. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+		
+		++AuditStats.NumOrphanedLinks;
+		RegionRecordByBuildable.Remove(Handle);
+		return;
+	}
+
+	AuditUnreferencedHandle(Handle);
+}
+
+void AAutoSupportModSubsystem::AuditUnreferencedHandle(const FAutoSupportBuildableHandle& Handle)
+{
+	if (Handle.Buildable.IsValid())
+	{
+		++AuditStats.NumHealthy;
+		return;
+	}
+
+	if (!Handle.IsConsideredLightweight())
+	{
+		MOD_LOG(Warning, TEXT("Audit: buildable is gone. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+		
+		++AuditStats.NumMissingBuildables;
+		AuditStats.Orphans.Add(Handle);
+		return;
+	}
+
+	if (FLightweightBuildableInstanceRef FoundRef; FindIndexedLightweightInstance(AuditInstanceIndex, Handle, FoundRef))
+	{
+		++AuditStats.NumHealthy;
+		return;
+	}
+
+	MOD_LOG(Warning, TEXT("Audit: lightweight instance is gone. Handle: [%s]"), TEXT_STR(Handle.ToString()))
 	
-	TArray<FAutoSupportBuildableHandle> HandlesToRemove;
+	++AuditStats.NumMissingInstances;
+	AuditStats.Orphans.Add(Handle);
+}
+
+void AAutoSupportModSubsystem::AuditProxyHandle(const FAutoSupportBuildableHandle& Handle, const TWeakObjectPtr<ABuildableAutoSupportProxy>& WeakProxy)
+{
+	++AuditStats.NumHandlesChecked;
 	
-	for (const auto& Entry : ProxyByBuildable)
+	auto* Proxy = WeakProxy.Get();
+
+	if (!IsValid(Proxy))
 	{
-		if (Entry.Value == Proxy)
+		// The proxy missed OnProxyDestroyed, so all of its links are orphaned, not just this one. Repaired by the weak key, the proxy is gone.
+		if (FAutoSupportProxyHandleSet ProxyHandles; HandlesByProxy.RemoveAndCopyValue(WeakProxy, ProxyHandles))
+		{
+			for (const auto& ProxyHandle : ProxyHandles.Handles)
+			{
+				ProxyByBuildable.Remove(ProxyHandle);
+			}
+			
+			AuditStats.NumOrphanedLinks += ProxyHandles.Handles.Num();
+		}
+
+		if (ProxyByBuildable.Remove(Handle) > 0)
 		{
-			HandlesToRemove.Add(Entry.Key);
+			++AuditStats.NumOrphanedLinks;
 		}
+		
+		AllProxies.Remove(WeakProxy);
+		
+		MOD_LOG(Warning, TEXT("Audit: removed the links of a destroyed proxy. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+		return;
+	}
+
+	if (Proxy->IsLoadResolvePending() || Proxy->IsInDismantleTransaction())
+	{
+		++AuditStats.NumSkipped;
+		return;
+	}
+
+	// Use the proxy's own part, its buildable is the current one.
+	const auto PartIndex = Proxy->FindPartIndex(Handle);
+
+	if (PartIndex != INDEX_NONE && Proxy->GetPartBuildable(PartIndex))
+	{
+		++AuditStats.NumHealthy;
+		return;
+	}
+
+	if (!Handle.IsConsideredLightweight())
+	{
+		MOD_LOG(Warning, TEXT("Audit: buildable is gone. Handle: [%s], Proxy: [%s]"), TEXT_STR(Handle.ToString()), TEXT_ACTOR_NAME(Proxy))
+		
+		++AuditStats.NumMissingBuildables;
+		AuditStats.Orphans.Add(Handle);
+		return;
+	}
+
+	// A ref is only healthy if it still points at an instance matching the handle. Runtime indexes can shift as instances are removed.
+	if (const auto* InstanceRef = Proxy->FindLightweightRef(Handle); InstanceRef && InstanceRef->IsValid() && FAutoSupportBuildableHandle(*InstanceRef) == Handle)
+	{
+		++AuditStats.NumHealthy;
+		return;
+	}
+
+	if (FLightweightBuildableInstanceRef FoundRef; FindIndexedLightweightInstance(AuditInstanceIndex, Handle, FoundRef))
+	{
+		Proxy->RepairLightweightRef(Handle, FoundRef);
+		++AuditStats.NumRepaired;
+		return;
 	}
 
-	MOD_LOG(Verbose, TEXT("Found %i entries to remove"), HandlesToRemove.Num())
+	MOD_LOG(Warning, TEXT("Audit: lightweight instance is gone. Handle: [%s], Proxy: [%s]"), TEXT_STR(Handle.ToString()), TEXT_ACTOR_NAME(Proxy))
+	
+	++AuditStats.NumMissingInstances;
+	AuditStats.Orphans.Add(Handle);
+}
+
+void AAutoSupportModSubsystem::FinishAudit()
+{
+	AuditStats.EndTime = GetWorld()->GetTimeSeconds();
+	AuditInstanceIndex.Reset();
 	
-	for (const auto& Handle : HandlesToRemove)
+	LastAuditStats = MoveTemp(AuditStats);
+	AuditStats = FAutoSupportAuditStats();
+	bHasCompletedAudit = true;
+
+	LogAuditSummary(LastAuditStats, bLogAuditSummary ? ELogVerbosity::Display : ELogVerbosity::Verbose);
+	bLogAuditSummary = false;
+}
+
+void AAutoSupportModSubsystem::LogLastAuditSummary() const
+{
+	if (!bHasCompletedAudit)
 	{
-		ProxyByBuildable.Remove(Handle);
+		MOD_LOG(Display, TEXT("No audit completed yet."))
+		return;
 	}
 
-	AllProxies.Remove(Proxy);
+	LogAuditSummary(LastAuditStats, ELogVerbosity::Display);
 }
 
-#pragma region IFGSaveInterface
+void AAutoSupportModSubsystem::LogAuditSummary(const FAutoSupportAuditStats& Stats, const ELogVerbosity::Type Verbosity)
+{
+	const auto Summary = FString::Printf(
+		TEXT("Audit of %i handles over %.1f s: %i healthy, %i repaired, %i skipped. Orphans: %i links to destroyed proxies or region records removed, %i missing buildables, %i missing lightweight instances."),
+		Stats.NumHandlesChecked,
+		Stats.EndTime - Stats.StartTime,
+		Stats.NumHealthy,
+		Stats.NumRepaired,
+		Stats.NumSkipped,
+		Stats.NumOrphanedLinks,
+		Stats.NumMissingBuildables,
+		Stats.NumMissingInstances);
 
-void AAutoSupportModSubsystem::PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
+	if (Verbosity != ELogVerbosity::Display)
+	{
+		MOD_LOG(Verbose, TEXT("%s"), *Summary)
+		return;
+	}
+	
+	MOD_LOG(Display, TEXT("%s"), *Summary)
+
+	// Enough to go looking for them, without flooding the log.
+	constexpr auto MaxListedOrphans = 20;
+	
+	for (auto i = 0; i < FMath::Min(Stats.Orphans.Num(), MaxListedOrphans); ++i)
+	{
+		MOD_LOG(Display, TEXT("  Orphan: [%s]"), TEXT_STR(Stats.Orphans[i].ToString()))
+	}
+}
+
+void AAutoSupportModSubsystem::TickCompaction()
 {
-	LastAutoSupportData.ClearInvalidReferences();
+	const auto Now = GetWorld()->GetTimeSeconds();
+	
+	if (CompactionQueue.IsEmpty())
+	{
+		// Loaded proxies are compacted once they are resolved.
+		const auto bIsSweepDue = Now - LastCompactionEndTime >= AUTOSUPPORT_COMPACTION_SWEEP_INTERVAL || IsSaveExpectedSoon(Now);
+		
+		if (!bIsSweepDue || AllProxies.IsEmpty() || !PendingLightweightResolves.IsEmpty())
+		{
+			return;
+		}
+
+		CompactionQueue = AllProxies.Array();
+		CompactionStats = FAutoSupportCompactionStats();
+		CompactionStats.StartTime = Now;
+	}
+
+	for (auto Budget = AUTOSUPPORT_COMPACTION_PROXIES_PER_FRAME; Budget > 0 && !CompactionQueue.IsEmpty(); --Budget)
+	{
+		if (auto* Proxy = CompactionQueue.Pop(false).Get(); IsValid(Proxy))
+		{
+			CompactProxy(Proxy);
+		}
+	}
+
+	if (!CompactionQueue.IsEmpty())
+	{
+		return;
+	}
+
+	LastCompactionEndTime = Now;
+	LastCompactionStats = CompactionStats;
+
+	// The sweep unlinked handles the filter still holds.
+	RebuildRemovalFilter();
+	
+	MOD_LOG(
+		Verbose,
+		TEXT("Compaction sweep done in %.1f s. Proxies: %i visited, %i skipped, %i destroyed empty. Handles: %i dead, %i duplicate."),
+		Now - CompactionStats.StartTime,
+		CompactionStats.NumProxiesVisited,
+		CompactionStats.NumProxiesSkipped,
+		CompactionStats.NumEmptyProxiesDestroyed,
+		CompactionStats.NumDeadHandles,
+		CompactionStats.NumDuplicateHandles)
 }
 
-void AAutoSupportModSubsystem::PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+bool AAutoSupportModSubsystem::IsSaveExpectedSoon(const double Now) const
+{
+	if (ObservedSaveInterval <= 0)
+	{
+		return false;
+	}
+
+	// Long enough to sweep every proxy at the budget at 30 frames a second, with some margin.
+	const auto SweepLead = AllProxies.Num() / static_cast<double>(AUTOSUPPORT_COMPACTION_PROXIES_PER_FRAME) / 30.0 + AUTOSUPPORT_COMPACTION_SAVE_LEAD;
+	const auto SweepStartTime = LastSaveTime + ObservedSaveInterval - SweepLead;
+
+	return Now >= SweepStartTime && LastCompactionEndTime < SweepStartTime;
+}
+
+void AAutoSupportModSubsystem::FlushCompaction()
+{
+	if (CompactionQueue.IsEmpty())
+	{
+		return;
+	}
+
+	MOD_LOG(Verbose, TEXT("Flushing %i proxies of the compaction sweep before saving."), CompactionQueue.Num())
+
+	while (!CompactionQueue.IsEmpty())
+	{
+		if (auto* Proxy = CompactionQueue.Pop(false).Get(); IsValid(Proxy))
+		{
+			CompactProxy(Proxy, false);
+		}
+	}
+
+	// Not counted as a finished sweep, the empty proxies it left still need one.
+	LastCompactionStats = CompactionStats;
+}
+
+void AAutoSupportModSubsystem::CompactProxy(ABuildableAutoSupportProxy* Proxy, const bool bDestroyIfEmpty)
 {
+	TArray<FAutoSupportBuildableHandle> DeadHandles;
+	int32 NumDuplicates;
+
+	++CompactionStats.NumProxiesVisited;
+	
+	if (!Proxy->CompactHandles(DeadHandles, NumDuplicates))
+	{
+		++CompactionStats.NumProxiesSkipped;
+		return;
+	}
+
+	CompactionStats.NumDeadHandles += DeadHandles.Num();
+	CompactionStats.NumDuplicateHandles += NumDuplicates;
+
+	if (!DeadHandles.IsEmpty())
+	{
+		UnlinkHandles(Proxy, DeadHandles);
+	}
+
+	if (bDestroyIfEmpty && Proxy->DestroyIfEmpty(false))
+	{
+		++CompactionStats.NumEmptyProxiesDestroyed;
+	}
+}
+
+void AAutoSupportModSubsystem::QueueLightweightResolve(ABuildableAutoSupportProxy* Proxy)
+{
+	fgcheck(Proxy);
+	PendingLightweightResolves.Add(Proxy);
+	bLoadResolveQueueDirty = true;
+}
+
+void AAutoSupportModSubsystem::QueueDismantleCommit(ABuildableAutoSupportProxy* Proxy)
+{
+	fgcheck(Proxy);
+	PendingDismantleCommits.Add(Proxy);
+}
+
+void AAutoSupportModSubsystem::CommitPendingDismantles()
+{
+	auto Proxies = MoveTemp(PendingDismantleCommits);
+	PendingDismantleCommits.Reset();
+
+	TArray<FAutoSupportBuildableHandle> RemovedHandles;
+	
+	for (const auto& WeakProxy : Proxies)
+	{
+		auto* Proxy = WeakProxy.Get();
+
+		// Destroyed proxies were already unlinked in OnProxyDestroyed.
+		if (!IsValid(Proxy) || !Proxy->IsInDismantleTransaction())
+		{
+			continue;
+		}
+
+		Proxy->CommitDismantleTransaction(RemovedHandles);
+		UnlinkHandles(Proxy, RemovedHandles);
+		Proxy->DestroyIfEmpty(false);
+	}
+}
+
+void AAutoSupportModSubsystem::UnlinkHandles(const ABuildableAutoSupportProxy* Proxy, const TArray<FAutoSupportBuildableHandle>& Handles)
+{
+	MOD_LOG(Verbose, TEXT("Unlinking %i handles from proxy [%s]"), Handles.Num(), TEXT_STR(Proxy->GetName()))
+	
+	auto* ProxyHandles = HandlesByProxy.Find(Proxy);
+	PendingPartsRemovedEvents.FindOrAdd(Proxy).Append(Handles);
+	
+	for (const auto& Handle : Handles)
+	{
+		ProxyByBuildable.Remove(Handle);
+
+		if (ProxyHandles)
+		{
+			ProxyHandles->Handles.Remove(Handle);
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::ResolvePendingLightweights()
+{
+	FVector FocusLocation;
+	const auto bHasFocus = GetLoadResolveFocus(FocusLocation);
+
+	if (bLoadResolveQueueDirty && bHasFocus)
+	{
+		// Farthest first, so the nearest pop off the end first.
+		PendingLightweightResolves.RemoveAll([](const TWeakObjectPtr<ABuildableAutoSupportProxy>& Proxy)
+		{
+			return !Proxy.IsValid();
+		});
+		
+		PendingLightweightResolves.Sort([&FocusLocation](const TWeakObjectPtr<ABuildableAutoSupportProxy>& A, const TWeakObjectPtr<ABuildableAutoSupportProxy>& B)
+		{
+			return FVector::DistSquared(FocusLocation, A->GetActorLocation()) > FVector::DistSquared(FocusLocation, B->GetActorLocation());
+		});
+		
+		bLoadResolveQueueDirty = false;
+	}
+
+	constexpr auto ImmediateRadiusSquared = AUTOSUPPORT_LOAD_RESOLVE_IMMEDIATE_RADIUS * AUTOSUPPORT_LOAD_RESOLVE_IMMEDIATE_RADIUS;
+	auto NumResolved = 0;
+	
+	while (!PendingLightweightResolves.IsEmpty())
+	{
+		const auto& Next = PendingLightweightResolves.Last();
+		const auto bIsNear = bHasFocus && Next.IsValid() && FVector::DistSquared(FocusLocation, Next->GetActorLocation()) <= ImmediateRadiusSquared;
+
+		// Everything near the players resolves now, regardless of the budget.
+		if (NumResolved >= AUTOSUPPORT_LOAD_RESOLVE_PROXIES_PER_FRAME && !bIsNear)
+		{
+			break;
+		}
+		
+		// Resolved out of turn if no longer pending.
+		if (auto* Proxy = PendingLightweightResolves.Pop(false).Get(); IsValid(Proxy) && Proxy->IsLoadResolvePending())
+		{
+			ResolveProxyLightweights(Proxy);
+			++NumResolved;
+		}
+	}
+
+	MOD_LOG(Verbose, TEXT("Resolved %i proxies, %i still queued."), NumResolved, PendingLightweightResolves.Num())
+
+	if (PendingLightweightResolves.IsEmpty())
+	{
+		LoadResolveInstanceIndex.Reset();
+	}
+}
+
+void AAutoSupportModSubsystem::ResolveLightweightsNow(ABuildableAutoSupportProxy* Proxy)
+{
+	fgcheck(Proxy);
+	
+	if (Proxy->IsLoadResolvePending())
+	{
+		ResolveProxyLightweights(Proxy);
+	}
+}
+
+void AAutoSupportModSubsystem::ResolveProxyLightweights(ABuildableAutoSupportProxy* Proxy)
+{
+	TMap<FAutoSupportBuildableHandle, FLightweightBuildableInstanceRef> RefsByHandle;
+	TArray<FAutoSupportBuildableHandle> Handles;
+	Proxy->AppendHandles(Handles);
+	
+	for (const auto& Handle : Handles)
+	{
+		if (FLightweightBuildableInstanceRef InstanceRef; Handle.IsConsideredLightweight() && FindIndexedLightweightInstance(LoadResolveInstanceIndex, Handle, InstanceRef))
+		{
+			RefsByHandle.Add(Handle, InstanceRef);
+		}
+	}
+
+	MOD_LOG(VeryVerbose, TEXT("Resolved %i lightweight handles of proxy [%s]"), RefsByHandle.Num(), TEXT_ACTOR_NAME(Proxy))
+	
+	Proxy->ResolveLightweightRefs(RefsByHandle);
+
+	// Resolving destroys the proxy if none of its parts remain.
+	if (IsValid(Proxy))
+	{
+		PendingLoadResolvedEvents.Add(Proxy);
+	}
+}
+
+bool AAutoSupportModSubsystem::GetLoadResolveFocus(FVector& OutLocation) const
+{
+	for (auto Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (const auto* Pawn = Iterator->IsValid() ? (*Iterator)->GetPawn() : nullptr)
+		{
+			OutLocation = Pawn->GetActorLocation();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool AAutoSupportModSubsystem::FindIndexedLightweightInstance(
+	TMap<TSubclassOf<AFGBuildable>, TMap<FAutoSupportBuildableHandle, int32>>& IndexByClass,
+	const FAutoSupportBuildableHandle& Handle,
+	FLightweightBuildableInstanceRef& OutInstanceRef) const
+{
+	auto* LightBuildables = AFGLightweightBuildableSubsystem::Get(GetWorld());
+	const auto BuildableClass = Handle.GetBuildableClass();
+
+	// One pass over the class's instances, then every handle of the class is a tolerance lookup.
+	const auto BuildIndex = [&]() -> TMap<FAutoSupportBuildableHandle, int32>&
+	{
+		auto& InstanceIndex = IndexByClass.Add(BuildableClass);
+
+		if (const auto* Instances = LightBuildables->mBuildableClassToInstanceArray.Find(BuildableClass))
+		{
+			InstanceIndex.Reserve(Instances->Num());
+			
+			for (auto RuntimeIndex = 0; RuntimeIndex < Instances->Num(); ++RuntimeIndex)
+			{
+				InstanceIndex.Add(FAutoSupportBuildableHandle(BuildableClass, (*Instances)[RuntimeIndex].Transform), RuntimeIndex);
+			}
+		}
+
+		return InstanceIndex;
+	};
+
+	auto* InstanceIndex = IndexByClass.Find(BuildableClass);
+	auto bIsFreshIndex = false;
+	
+	if (!InstanceIndex)
+	{
+		InstanceIndex = &BuildIndex();
+		bIsFreshIndex = true;
+	}
+
+	for (;;)
+	{
+		FAutoSupportBuildableHandle Match;
+		
+		if (Handle.FindInWithTolerance(*InstanceIndex, Match))
+		{
+			OutInstanceRef.Initialize(LightBuildables, BuildableClass, InstanceIndex->FindChecked(Match));
+
+			if (OutInstanceRef.IsValid() && FAutoSupportBuildableHandle(OutInstanceRef) == Match)
+			{
+				return true;
+			}
+		}
+
+		// Not there, or moved since the index was built. A fresh index is the truth.
+		if (bIsFreshIndex)
+		{
+			return false;
+		}
+
+		InstanceIndex = &BuildIndex();
+		bIsFreshIndex = true;
+	}
+}
+
+void AAutoSupportModSubsystem::BenchmarkHandleLookups(const int32 Iterations) const
+{
+	TArray<FAutoSupportBuildableHandle> Keys;
+	ProxyByBuildable.GenerateKeyArray(Keys);
+
+	// Without a populated world, time a synthetic map of the same shape instead.
+	TMap<FAutoSupportBuildableHandle, TWeakObjectPtr<ABuildableAutoSupportProxy>> SyntheticMap;
+	const auto* Map = &ProxyByBuildable;
+	
+	if (Keys.IsEmpty())
+	{
+		constexpr auto NumSyntheticHandles = 10000;
+		const FRandomStream Random(312);
+		
+		for (auto i = 0; i < NumSyntheticHandles; ++i)
+		{
+			const FVector Location(Random.FRandRange(-300000, 300000), Random.FRandRange(-300000, 300000), Random.FRandRange(-20000, 50000));
+			SyntheticMap.Add(FAutoSupportBuildableHandle(AFGBuildable::StaticClass(), FTransform(Location)), nullptr);
+		}
+
+		SyntheticMap.GenerateKeyArray(Keys);
+		Map = &SyntheticMap;
+	}
+
+	// Nudge each key within tolerance to exercise the neighbour cell probes.
+	TArray<FAutoSupportBuildableHandle> NudgedKeys;
+	NudgedKeys.Reserve(Keys.Num());
+	
+	for (const auto& Key : Keys)
+	{
+		auto NudgedTransform = Key.GetTransform();
+		NudgedTransform.AddToTranslation(FVector(AUTOSUPPORT_TRANSFORM_EQUALITY_TOLERANCE * 0.5));
+		
+		auto& NudgedKey = NudgedKeys.Emplace_GetRef(Key.GetBuildableClass(), NudgedTransform);
+		NudgedKey.Buildable = Key.Buildable;
+	}
+
+	int32 NumFound = 0;
+	FAutoSupportBuildableHandle Match;
+	
+	auto StartTime = FPlatformTime::Seconds();
+	for (auto Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		for (const auto& Key : Keys)
+		{
+			NumFound += Map->Contains(Key) ? 1 : 0;
+		}
+	}
+	const auto ExactSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int32 NumNudgedFound = 0;
+	
+	StartTime = FPlatformTime::Seconds();
+	for (auto Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		for (const auto& NudgedKey : NudgedKeys)
+		{
+			NumNudgedFound += NudgedKey.FindInWithTolerance(*Map, Match) ? 1 : 0;
+		}
+	}
+	const auto ToleranceSeconds = FPlatformTime::Seconds() - StartTime;
+
+	const auto NumLookups = FMath::Max(1, Keys.Num() * Iterations);
+	
+	MOD_LOG(
+		Display,
+		TEXT("%i handles (%s), %i iterations. Exact: %.1f ns/lookup, %i found. Tolerance: %.1f ns/lookup, %i found."),
+		Keys.Num(),
+		Map == &SyntheticMap ? TEXT("synthetic") : TEXT("world"),
+		Iterations,
+		ExactSeconds * 1e9 / NumLookups,
+		NumFound,
+		ToleranceSeconds * 1e9 / NumLookups,
+		NumNudgedFound)
+}
+
+void AAutoSupportModSubsystem::LogHandleMemoryReport() const
+{
+	int32 NumProxies = 0;
+	int32 NumParts = 0;
+	SIZE_T Bytes = 0;
+	SIZE_T HandleBytes = 0;
+	SIZE_T SavedBytes = 0;
+
+	for (const auto& WeakProxy : AllProxies)
+	{
+		const auto* Proxy = WeakProxy.Get();
+		if (!Proxy)
+		{
+			continue;
+		}
+
+		SIZE_T ProxyBytes, ProxyHandleBytes, ProxySavedBytes;
+		Proxy->GetHandleMemoryUsage(ProxyBytes, ProxyHandleBytes, ProxySavedBytes);
+
+		++NumProxies;
+		NumParts += Proxy->GetNumParts();
+		Bytes += ProxyBytes;
+		HandleBytes += ProxyHandleBytes;
+		SavedBytes += ProxySavedBytes;
+	}
+
+	const auto PerPart = [NumParts](const SIZE_T TotalBytes)
+	{
+		return NumParts > 0 ? static_cast<double>(TotalBytes) / NumParts : 0.0;
+	};
+
+	MOD_LOG(
+		Display,
+		TEXT("%i proxies, %i parts. Runtime, handles with refs keyed by handle (before): %.1f B/part (%llu B). Runtime, part layout (now): %.1f B/part (%llu B). Save encoding, not held at runtime: %.1f B/part (%llu B)."),
+		NumProxies,
+		NumParts,
+		PerPart(HandleBytes),
+		static_cast<uint64>(HandleBytes),
+		PerPart(Bytes),
+		static_cast<uint64>(Bytes),
+		PerPart(SavedBytes),
+		static_cast<uint64>(SavedBytes))
+}
+
+bool AAutoSupportModSubsystem::MayBeRegistered(const AFGBuildable* Buildable) const
+{
+	if (!Buildable || !RemovalFilterClasses.Contains(Buildable->GetClass()))
+	{
+		return false;
+	}
+
+	// Probe the same cells a tolerance lookup would.
+	TArray<uint64, TInlineAllocator<8>> ProbeKeys;
+	FAutoSupportBuildableHandle::GetToleranceProbeKeys(Buildable->GetActorLocation(), ProbeKeys);
+
+	for (const auto Key : ProbeKeys)
+	{
+		if (RemovalFilter.MayContain(MakeRemovalFilterKey(Buildable->GetClass(), Key)))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void AAutoSupportModSubsystem::AddToRemovalFilter(const FAutoSupportBuildableHandle& Handle)
+{
+	RemovalFilterClasses.Add(Handle.GetBuildableClass());
+	RemovalFilter.Add(MakeRemovalFilterKey(Handle.GetBuildableClass(), Handle.GetLocationKey()));
+
+	if (RemovalFilter.IsOverCapacity())
+	{
+		RebuildRemovalFilter();
+	}
+}
+
+void AAutoSupportModSubsystem::RebuildRemovalFilter()
+{
+	const auto NumHandles = ProxyByBuildable.Num() + SinglePartSupports.Num() + RegionRecordByBuildable.Num();
+
+	// Room to double before the next rebuild, so growing to N handles costs O(N) in rebuilds overall.
+	RemovalFilterClasses.Reset();
+	RemovalFilter.Reset(NumHandles * 2);
+
+	const auto AddHandle = [this](const FAutoSupportBuildableHandle& Handle)
+	{
+		RemovalFilterClasses.Add(Handle.GetBuildableClass());
+		RemovalFilter.Add(MakeRemovalFilterKey(Handle.GetBuildableClass(), Handle.GetLocationKey()));
+	};
+
+	for (const auto& Entry : ProxyByBuildable)
+	{
+		AddHandle(Entry.Key);
+	}
+
+	for (const auto& Handle : SinglePartSupports)
+	{
+		AddHandle(Handle);
+	}
+
+	for (const auto& Entry : RegionRecordByBuildable)
+	{
+		AddHandle(Entry.Key);
+	}
+
+	MOD_LOG(Verbose, TEXT("Rebuilt the removal filter with %i handles of %i classes, %u bits."), NumHandles, RemovalFilterClasses.Num(), RemovalFilter.GetNumBits())
+}
+
+uint64 AAutoSupportModSubsystem::MakeRemovalFilterKey(const UClass* BuildableClass, const uint64 LocationKey)
+{
+	// Keyed by class too, so a removed foundation only passes where a foundation part is registered, not where any part is.
+	return LocationKey ^ static_cast<uint64>(PointerHash(BuildableClass)) * 0x9e3779b97f4a7c15ull;
+}
+
+void AAutoSupportModSubsystem::OnWorldBuildableRemoved(AFGBuildable* Buildable)
+{
+	if (!MayBeRegistered(Buildable))
+	{
+		return;
+	}
+	
+	const FAutoSupportBuildableHandle RemovedHandle(Buildable);
+	FAutoSupportBuildableHandle Handle;
+
+	if (RemovedHandle.FindInWithTolerance(SinglePartSupports, Handle))
+	{
+		// A temporary being cleaned up does not remove its lightweight instance.
+		if (Buildable->GetIsLightweightTemporary())
+		{
+			FLightweightBuildableInstanceRef InstanceRef;
+			InstanceRef.InitializeFromTemporary(Buildable);
+			
+			if (InstanceRef.IsValid())
+			{
+				return;
+			}
+		}
+		
+		MOD_LOG(Verbose, TEXT("Removing single part support. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+		SinglePartSupports.Remove(Handle);
+		return;
+	}
+
+	if (!RemovedHandle.FindInWithTolerance(ProxyByBuildable, Handle))
+	{
+		if (RemovedHandle.FindInWithTolerance(RegionRecordByBuildable, Handle))
+		{
+			OnRegionBuildableRemoved(Buildable, Handle);
+		}
+		
+		return;
+	}
+	
+	const auto* ProxyEntry = ProxyByBuildable.Find(Handle);
+
+	if (!ProxyEntry || !ProxyEntry->IsValid())
+	{
+		return;
+	}
+	
+	// The links are removed in one batch when the proxy's dismantle transaction is committed.
+	ProxyEntry->Get()->UnregisterHandle(Handle);
+}
+
+TSubclassOf<UFGRecipe> AAutoSupportModSubsystem::GetBuildRecipe(const TSubclassOf<AFGBuildable> BuildableClass)
+{
+	if (!BuildableClass)
+	{
+		return nullptr;
+	}
+	
+	if (const auto* Recipe = BuildRecipeByClass.Find(BuildableClass))
+	{
+		return *Recipe;
+	}
+
+	RebuildBuildRecipeTable();
+	
+	return BuildRecipeByClass.FindRef(BuildableClass);
+}
+
+void AAutoSupportModSubsystem::RebuildBuildRecipeTable()
+{
+	auto* RecipeManager = AFGRecipeManager::Get(GetWorld());
+	if (!RecipeManager)
+	{
+		return;
+	}
+
+	TArray<TSubclassOf<UFGRecipe>> Recipes;
+	RecipeManager->GetAllAvailableRecipes(Recipes);
+
+	// Nothing new was unlocked since the last build, so a missing class stays missing.
+	if (Recipes.Num() == NumAvailableRecipesAtTableBuild)
+	{
+		return;
+	}
+
+	NumAvailableRecipesAtTableBuild = Recipes.Num();
+	BuildRecipeByClass.Reset();
+
+	for (const auto& Recipe : Recipes)
+	{
+		for (const auto& Product : UFGRecipe::GetProducts(Recipe))
+		{
+			if (!Product.ItemClass || !Product.ItemClass->IsChildOf<UFGBuildingDescriptor>())
+			{
+				continue;
+			}
+			
+			if (const auto BuildableClass = UFGBuildingDescriptor::GetBuildableClass(TSubclassOf<UFGBuildingDescriptor>(Product.ItemClass.Get())))
+			{
+				BuildRecipeByClass.Add(BuildableClass, Recipe);
+			}
+		}
+	}
+	
+	MOD_LOG(Verbose, TEXT("Built the build recipe table. %i buildable classes from %i recipes."), BuildRecipeByClass.Num(), Recipes.Num())
+}
+
+void AAutoSupportModSubsystem::GetHandlesRefund(const TArray<FAutoSupportBuildableHandle>& Handles, TArray<FInventoryStack>& OutRefund)
+{
+	TMap<TSubclassOf<UFGItemDescriptor>, int32> ItemCounts;
+
+	for (const auto& Handle : Handles)
+	{
+		// The recipe a part was actually built with wins when the part is around to ask.
+		auto Recipe = Handle.Buildable.IsValid() ? Handle.Buildable->GetBuiltWithRecipe() : nullptr;
+
+		if (!Recipe)
+		{
+			Recipe = GetBuildRecipe(Handle.GetBuildableClass());
+		}
+
+		if (!Recipe)
+		{
+			MOD_LOG(Warning, TEXT("No build recipe found. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+			continue;
+		}
+
+		for (const auto& Ingredient : UFGRecipe::GetIngredients(Recipe))
+		{
+			ItemCounts.FindOrAdd(Ingredient.ItemClass) += Ingredient.Amount;
+		}
+	}
+
+	for (const auto& ItemCount : ItemCounts)
+	{
+		OutRefund.Add(FInventoryStack(ItemCount.Value, ItemCount.Key));
+	}
+}
+
+void AAutoSupportModSubsystem::FilterDismantleableProxies(const TArray<ABuildableAutoSupportProxy*>& Proxies, TArray<ABuildableAutoSupportProxy*>& OutProxies)
+{
+	OutProxies.Reset(Proxies.Num());
+	
+	TArray<AActor*> SelectedActors;
+	SelectedActors.Reserve(Proxies.Num());
+
+	for (auto* Proxy : Proxies)
+	{
+		if (IsValid(Proxy))
+		{
+			SelectedActors.Add(Proxy);
+		}
+	}
+
+	TArray<TSubclassOf<UFGConstructDisqualifier>> Disqualifiers;
+	
+	for (auto* Actor : SelectedActors)
+	{
+		auto* Proxy = CastChecked<ABuildableAutoSupportProxy>(Actor);
+		
+		if (Proxy->GetBlueprintProxy() || !IFGDismantleInterface::Execute_CanDismantle(Proxy))
+		{
+			continue;
+		}
+
+		Disqualifiers.Reset();
+		IFGDismantleInterface::Execute_GetDismantleDisqualifiers(Proxy, Disqualifiers, SelectedActors);
+
+		if (Disqualifiers.IsEmpty())
+		{
+			OutProxies.Add(Proxy);
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::DismantleProxies(const TArray<ABuildableAutoSupportProxy*>& SelectedProxies, AFGCharacterPlayer* Player)
+{
+	fgcheck(Player);
+	fgcheck(HasAuthority());
+
+	// Filtered before the refund is summed, so nothing refunded is left standing or refunded again by a blueprint.
+	TArray<ABuildableAutoSupportProxy*> Proxies;
+	FilterDismantleableProxies(SelectedProxies, Proxies);
+
+	if (Proxies.Num() != SelectedProxies.Num())
+	{
+		MOD_LOG(Verbose, TEXT("Skipping %i of %i selected proxies that cannot be dismantled in a batch."), SelectedProxies.Num() - Proxies.Num(), SelectedProxies.Num())
+	}
+
+	// One refund for the whole batch. Summed before anything is dismantled, the handles go away with the parts.
+	TArray<FAutoSupportBuildableHandle> AllHandles;
+	FBox RefundArea(ForceInit);
+	
+	for (const auto* Proxy : Proxies)
+	{
+		if (IsValid(Proxy))
+		{
+			Proxy->AppendHandles(AllHandles);
+			RefundArea += Proxy->GetWorldBounds();
+		}
+	}
+
+	auto* Inventory = Player->GetInventory();
+	TArray<FInventoryStack> Refund;
+
+	if (!Inventory->GetNoBuildCost())
+	{
+		GetHandlesRefund(AllHandles, Refund);
+	}
+	
+	MOD_LOG(Verbose, TEXT("Dismantling %i proxies with %i parts."), Proxies.Num(), AllHandles.Num())
+
+	// Each proxy unlinks all its handles in one go when destroyed.
+	for (auto* Proxy : Proxies)
+	{
+		if (IsValid(Proxy))
+		{
+			IFGDismantleInterface::Execute_Dismantle(Proxy);
+		}
+	}
+
+	GiveDismantleRefund(Player, Refund, RefundArea.IsValid ? RefundArea.GetCenter() : Player->GetActorLocation());
+}
+
+void AAutoSupportModSubsystem::GiveDismantleRefund(AFGCharacterPlayer* Player, const TArray<FInventoryStack>& Refund, const FVector& CrateLocation)
+{
+	fgcheck(Player);
+	fgcheck(HasAuthority());
+	
+	auto* Inventory = Player->GetInventory();
+	TArray<FInventoryStack> Leftovers;
+	
+	for (const auto& Stack : Refund)
+	{
+		const auto NumAdded = Inventory->AddStack(Stack, true);
+
+		if (NumAdded < Stack.NumItems)
+		{
+			Leftovers.Add(FInventoryStack(Stack.NumItems - NumAdded, Stack.Item.GetItemClass()));
+		}
+	}
+
+	if (!Leftovers.IsEmpty())
+	{
+		MOD_LOG(Verbose, TEXT("Inventory is full, spawning a crate for %i stacks."), Leftovers.Num())
+		
+		AFGCrate* Crate = nullptr;
+		AFGItemPickup_Spawnable::SpawnInventoryCrate(GetWorld(), Leftovers, CrateLocation, {}, Crate);
+	}
+}
+
+ABuildableAutoSupportRegion* AAutoSupportModSubsystem::AddSupportToRegion(
+	const TSubclassOf<ABuildableAutoSupportRegion> RegionClass,
+	const FTransform& SupportTransform,
+	const FBox& LocalBounds,
+	const TArray<AFGBuildable*>& Buildables)
+{
+	fgcheck(RegionClass);
+	
+	const auto Cell = ABuildableAutoSupportRegion::GetRegionCell(SupportTransform.GetLocation());
+	auto* Region = RegionsByCell.FindRef(Cell).Get();
+
+	if (!IsValid(Region))
+	{
+		MOD_LOG(Verbose, TEXT("Spawning region for cell [%s]"), TEXT_STR(Cell.ToString()))
+		
+		const FTransform RegionTransform(ABuildableAutoSupportRegion::GetRegionCellCenter(Cell));
+		Region = GetWorld()->SpawnActorDeferred<ABuildableAutoSupportRegion>(
+			RegionClass,
+			RegionTransform,
+			nullptr,
+			nullptr,
+			ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		Region->SetCell(Cell);
+		Region->FinishSpawning(RegionTransform);
+	}
+
+	Region->AddRecord(SupportTransform, LocalBounds, Buildables);
+	
+	return Region;
+}
+
+void AAutoSupportModSubsystem::RegisterRegion(ABuildableAutoSupportRegion* Region)
+{
+	fgcheck(Region);
+
+	if (const auto* Existing = RegionsByCell.Find(Region->GetCell()); Existing && Existing->IsValid() && Existing->Get() != Region)
+	{
+		MOD_LOG(Warning, TEXT("Cell [%s] already has a region. Its records won't receive new supports."), TEXT_STR(Region->GetCell().ToString()))
+	}
+	else
+	{
+		RegionsByCell.Add(Region->GetCell(), Region);
+	}
+
+	for (auto i = 0; i < Region->NumRecords(); ++i)
+	{
+		LinkRegionRecord(Region, *Region->FindRecordByCollisionInstance(i));
+	}
+
+	if (const auto* GameInstance = GetWorld()->GetGameInstance())
+	{
+		for (const auto* LocalPlayer : GameInstance->GetLocalPlayers())
+		{
+			if (LocalPlayer)
+			{
+				const auto* ModLocalPlayerSubsys = LocalPlayer->GetSubsystem<UAutoSupportModLocalPlayerSubsystem>();
+				ModLocalPlayerSubsys->SyncRegionWithBuildGunState(Region);
+			}
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::OnRegionDestroyed(const ABuildableAutoSupportRegion* Region)
+{
+	// Records unlink themselves when removed, a region is only destroyed once it has none. Drop whatever is left regardless.
+	for (auto i = 0; i < Region->NumRecords(); ++i)
+	{
+		UnlinkRegionHandles(Region->FindRecordByCollisionInstance(i)->Handles);
+	}
+
+	if (const auto* Existing = RegionsByCell.Find(Region->GetCell()); Existing && Existing->Get() == Region)
+	{
+		RegionsByCell.Remove(Region->GetCell());
+	}
+}
+
+void AAutoSupportModSubsystem::LinkRegionRecord(ABuildableAutoSupportRegion* Region, const FAutoSupportRegionRecord& Record)
+{
+	const FAutoSupportRegionRecordRef RecordRef{ Region, Record.RecordId };
+	
+	for (const auto& Handle : Record.Handles)
+	{
+		RegionRecordByBuildable.Add(Handle, RecordRef);
+		AddToRemovalFilter(Handle);
+	}
+}
+
+void AAutoSupportModSubsystem::UnlinkRegionHandles(const TArray<FAutoSupportBuildableHandle>& Handles)
+{
+	for (const auto& Handle : Handles)
+	{
+		RegionRecordByBuildable.Remove(Handle);
+	}
+}
+
+void AAutoSupportModSubsystem::OnRegionBuildableRemoved(const AFGBuildable* Buildable, const FAutoSupportBuildableHandle& Handle)
+{
+	// A temporary being cleaned up does not remove its lightweight instance.
+	if (Buildable->GetIsLightweightTemporary())
+	{
+		FLightweightBuildableInstanceRef InstanceRef;
+		InstanceRef.InitializeFromTemporary(const_cast<AFGBuildable*>(Buildable));
+		
+		if (InstanceRef.IsValid())
+		{
+			return;
+		}
+	}
+
+	const auto RecordRef = RegionRecordByBuildable.FindRef(Handle);
+	RegionRecordByBuildable.Remove(Handle);
+
+	if (auto* Region = RecordRef.Region.Get())
+	{
+		Region->UnregisterRecordHandle(RecordRef.RecordId, Handle);
+	}
+}
+
+void AAutoSupportModSubsystem::GetRegions(TArray<ABuildableAutoSupportRegion*>& OutRegions) const
+{
+	OutRegions.Reserve(OutRegions.Num() + RegionsByCell.Num());
+	
+	for (const auto& Entry : RegionsByCell)
+	{
+		if (Entry.Value.IsValid())
+		{
+			OutRegions.Add(Entry.Value.Get());
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::DismantleHandleParts(const TArray<FAutoSupportBuildableHandle>& Handles)
+{
+	TArray<AFGBuildable*> Parts;
+	Parts.Reserve(Handles.Num());
+	
+	TSet<FAutoSupportBuildableHandle> WantedHandles;
+	TSet<TSubclassOf<AFGBuildable>> WantedClasses;
+	
+	for (const auto& Handle : Handles)
+	{
+		if (Handle.Buildable.IsValid() && !Handle.Buildable->GetIsLightweightTemporary())
+		{
+			Parts.Add(Handle.Buildable.Get());
+		}
+		else if (Handle.IsConsideredLightweight())
+		{
+			WantedHandles.Add(Handle);
+			WantedClasses.Add(Handle.GetBuildableClass());
+		}
+	}
+
+	// A single pass over the instances of each class. Temporaries are not trusted, they may have been cleaned up already.
+	auto* LightBuildables = AFGLightweightBuildableSubsystem::Get(GetWorld());
+	
+	for (const auto& BuildableClass : WantedClasses)
+	{
+		const auto* Instances = LightBuildables->mBuildableClassToInstanceArray.Find(BuildableClass);
+
+		if (!Instances)
+		{
+			continue;
+		}
+		
+		for (auto RuntimeIndex = 0; RuntimeIndex < Instances->Num() && !WantedHandles.IsEmpty(); ++RuntimeIndex)
+		{
+			const FAutoSupportBuildableHandle InstanceHandle(BuildableClass, (*Instances)[RuntimeIndex].Transform);
+
+			FAutoSupportBuildableHandle WantedHandle;
+			if (!InstanceHandle.FindInWithTolerance(WantedHandles, WantedHandle))
+			{
+				continue;
+			}
+
+			WantedHandles.Remove(WantedHandle);
+
+			FLightweightBuildableInstanceRef InstanceRef;
+			InstanceRef.Initialize(LightBuildables, BuildableClass, RuntimeIndex);
+
+			if (auto* Temporary = InstanceRef.IsValid() ? InstanceRef.SpawnTemporaryBuildable() : nullptr)
+			{
+				Temporary->SetBlockCleanupOfTemporary(true);
+				Parts.Add(Temporary);
+			}
+		}
+	}
+
+	if (!WantedHandles.IsEmpty())
+	{
+		MOD_LOG(Warning, TEXT("%i lightweight parts were not found. They were likely removed already."), WantedHandles.Num())
+	}
+
+	MOD_LOG(Verbose, TEXT("Dismantling %i parts of %i handles."), Parts.Num(), Handles.Num())
+	
+	for (auto* Part : Parts)
+	{
+		IFGDismantleInterface::Execute_Dismantle(Part);
+	}
+}
+
+void AAutoSupportModSubsystem::PreloadDescriptors(const FBuildableAutoSupportData& Data, FStreamableDelegate OnLoaded)
+{
+	TArray<FSoftObjectPath> Paths;
+	Data.GetDescriptorPaths(Paths);
+
+	RequestDescriptorLoads(Paths, MoveTemp(OnLoaded));
+}
+
+void AAutoSupportModSubsystem::PreloadSavedDescriptors()
+{
+	TArray<FSoftObjectPath> Paths;
+
+	LastAutoSupportData.GetDescriptorPaths(Paths);
+	LastAutoSupport1mData.GetDescriptorPaths(Paths);
+	LastAutoSupport2mData.GetDescriptorPaths(Paths);
+	LastAutoSupport4mData.GetDescriptorPaths(Paths);
+
+	for (const auto& Entry : AutoSupportPresets)
+	{
+		Entry.Value.GetDescriptorPaths(Paths);
+	}
+
+	RequestDescriptorLoads(Paths, FStreamableDelegate::CreateUObject(this, &AAutoSupportModSubsystem::OnSavedDescriptorsLoaded));
+}
+
+void AAutoSupportModSubsystem::RequestDescriptorLoads(const TArray<FSoftObjectPath>& Paths, FStreamableDelegate OnLoaded)
+{
+	if (Paths.IsEmpty())
+	{
+		OnLoaded.ExecuteIfBound();
+		return;
+	}
+	
+	MOD_LOG(Verbose, TEXT("Preloading %i descriptors"), Paths.Num())
+	
+	const auto Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Paths, MoveTemp(OnLoaded), FStreamableManager::AsyncLoadHighPriority);
+
+	if (!Handle.IsValid())
+	{
+		MOD_LOG(Warning, TEXT("Failed to request descriptor loads."))
+		return;
+	}
+	
+	// Pin the first handle requested for each descriptor so it stays loaded.
+	for (const auto& Path : Paths)
+	{
+		if (!DescriptorLoadHandles.Contains(Path))
+		{
+			DescriptorLoadHandles.Add(Path, Handle);
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::OnSavedDescriptorsLoaded()
+{
+	MOD_LOG(Verbose, TEXT("Saved descriptors loaded. Clearing any that failed to load."))
+	
+	// Anything not loaded by now is a reference to a descriptor that no longer exists (i.e. an uninstalled mod).
+	LastAutoSupportData.ClearInvalidReferences();
+	LastAutoSupport1mData.ClearInvalidReferences();
+	LastAutoSupport2mData.ClearInvalidReferences();
+	LastAutoSupport4mData.ClearInvalidReferences();
+
+	for (auto& Entry : AutoSupportPresets)
+	{
+		Entry.Value.ClearInvalidReferences();
+	}
+}
+
+void AAutoSupportModSubsystem::OnProxyDestroyed(const ABuildableAutoSupportProxy* Proxy)
+{
+	MOD_LOG(Verbose, TEXT("Invoked"))
+
+	if (FAutoSupportProxyHandleSet ProxyHandles; HandlesByProxy.RemoveAndCopyValue(Proxy, ProxyHandles))
+	{
+		MOD_LOG(Verbose, TEXT("Found %i entries to remove"), ProxyHandles.Handles.Num())
+		
+		for (const auto& Handle : ProxyHandles.Handles)
+		{
+			ProxyByBuildable.Remove(Handle);
+		}
+	}
+
+	AllProxies.Remove(Proxy);
+	ProxyGrid.Remove(Proxy);
+	RemoveProxyCollision(Proxy);
+
+	// Reported as destroyed only, whatever else happened to it this frame.
+	PendingRegisteredEvents.Remove(Proxy);
+	PendingLoadResolvedEvents.Remove(Proxy);
+	PendingPartsRemovedEvents.Remove(Proxy);
+	PendingDestroyedEvents.Add(Proxy);
+}
+
+void AAutoSupportModSubsystem::UpdateProxyBounds(ABuildableAutoSupportProxy* Proxy)
+{
+	fgcheck(Proxy);
+	
+	if (AllProxies.Contains(Proxy))
+	{
+		ProxyGrid.Update(Proxy, Proxy->GetWorldBounds());
+		UpdateProxyCollision(Proxy);
+	}
+}
+
+void AAutoSupportModSubsystem::UpdateProxyCollision(ABuildableAutoSupportProxy* Proxy)
+{
+	if (!UsesSharedProxyCollision())
+	{
+		return;
+	}
+
+	const auto Cell = ABuildableAutoSupportRegion::GetRegionCell(Proxy->GetWorldBounds().GetCenter());
+
+	if (const auto* OldCell = ProxyCollisionCellByProxy.Find(Proxy); OldCell && *OldCell != Cell)
+	{
+		RemoveProxyCollision(Proxy);
+	}
+
+	auto& Collision = ProxyCollisionByCell.FindOrAdd(Cell);
+
+	if (!IsValid(Collision))
+	{
+		MOD_LOG(Verbose, TEXT("Spawning proxy collision for cell [%s]"), TEXT_STR(Cell.ToString()))
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		
+		Collision = GetWorld()->SpawnActor<ABuildableAutoSupportProxyCollision>(
+			ProxyCollisionClass,
+			FTransform(ABuildableAutoSupportRegion::GetRegionCellCenter(Cell)),
+			SpawnParams);
+		
+		Collision->SetCollisionActive(IsProxyCollisionActive());
+	}
+
+	Collision->AddOrUpdateProxy(Proxy);
+	ProxyCollisionCellByProxy.Add(Proxy, Cell);
+}
+
+void AAutoSupportModSubsystem::RemoveProxyCollision(const ABuildableAutoSupportProxy* Proxy)
+{
+	FIntVector Cell;
+	if (!ProxyCollisionCellByProxy.RemoveAndCopyValue(Proxy, Cell))
+	{
+		return;
+	}
+
+	auto* Collision = ProxyCollisionByCell.FindRef(Cell);
+	
+	if (!IsValid(Collision))
+	{
+		return;
+	}
+
+	Collision->RemoveProxy(Proxy);
+
+	if (Collision->NumProxies() == 0)
+	{
+		ProxyCollisionByCell.Remove(Cell);
+		Collision->Destroy();
+	}
+}
+
+void AAutoSupportModSubsystem::SetProxyDismantleModeActive(const ULocalPlayer* LocalPlayer, const bool bActive)
+{
+	const auto bWasActive = IsProxyCollisionActive();
+
+	if (bActive)
+	{
+		ProxyDismantleModePlayers.Add(LocalPlayer);
+	}
+	else
+	{
+		ProxyDismantleModePlayers.Remove(LocalPlayer);
+	}
+
+	if (bWasActive == IsProxyCollisionActive())
+	{
+		return;
+	}
+
+	MOD_LOG(Verbose, TEXT("Proxy collision active: [%s], Cells: [%i]"), TEXT_BOOL(IsProxyCollisionActive()), ProxyCollisionByCell.Num())
+
+	for (const auto& Entry : ProxyCollisionByCell)
+	{
+		if (IsValid(Entry.Value))
+		{
+			Entry.Value->SetCollisionActive(IsProxyCollisionActive());
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::GetProxiesInBox(const FBox& Box, TArray<ABuildableAutoSupportProxy*>& OutProxies) const
+{
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> Proxies;
+	ProxyGrid.QueryBox(Box, Proxies);
+	GetValidProxies(Proxies, OutProxies);
+}
+
+void AAutoSupportModSubsystem::GetProxiesInRadius(const FVector& Center, const float Radius, TArray<ABuildableAutoSupportProxy*>& OutProxies) const
+{
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> Proxies;
+	ProxyGrid.QueryRadius(Center, Radius, Proxies);
+	GetValidProxies(Proxies, OutProxies);
+}
+
+void AAutoSupportModSubsystem::GetProxiesAlongRay(const FVector& Start, const FVector& End, TArray<ABuildableAutoSupportProxy*>& OutProxies) const
+{
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> Proxies;
+	ProxyGrid.QueryRay(Start, End, Proxies);
+	GetValidProxies(Proxies, OutProxies);
+}
+
+void AAutoSupportModSubsystem::GetValidProxies(const TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>>& Proxies, TArray<ABuildableAutoSupportProxy*>& OutProxies)
+{
+	OutProxies.Reserve(OutProxies.Num() + Proxies.Num());
+	
+	for (const auto& Proxy : Proxies)
+	{
+		if (Proxy.IsValid())
+		{
+			OutProxies.Add(Proxy.Get());
+		}
+	}
+}
+
+void AAutoSupportModSubsystem::RegisterSinglePartSupport(AFGBuildable* Buildable)
+{
+	fgcheck(Buildable);
+	const FAutoSupportBuildableHandle Handle(Buildable);
+	
+	MOD_LOG(Verbose, TEXT("Registering single part support. Handle: [%s]"), TEXT_STR(Handle.ToString()))
+	
+	SinglePartSupports.Add(Handle);
+	AddToRemovalFilter(Handle);
+}
+
+bool AAutoSupportModSubsystem::IsSinglePartSupport(AFGBuildable* Buildable) const
+{
+	FAutoSupportBuildableHandle Match;
+	return Buildable && FAutoSupportBuildableHandle(Buildable).FindInWithTolerance(SinglePartSupports, Match);
+}
+
+#pragma region IFGSaveInterface
+
+void AAutoSupportModSubsystem::PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	// Invalid references are cleared once the loads complete. Clearing now would drop descriptors that are not loaded yet.
+	PreloadSavedDescriptors();
+
+	for (const auto& Handle : SinglePartSupports)
+	{
+		AddToRemovalFilter(Handle);
+	}
+}
+
+void AAutoSupportModSubsystem::PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion)
+{
+	const auto Now = GetWorld()->GetTimeSeconds();
+	
+	if (LastSaveTime >= 0)
+	{
+		ObservedSaveInterval = Now - LastSaveTime;
+	}
+	
+	LastSaveTime = Now;
+
+	// A backstop for a save that came earlier than expected. Proxies already gathered for this save keep their dead handles until the next.
+	FlushCompaction();
+	
+	MOD_LOG(
+		Verbose,
+		TEXT("Saving %i proxies. Last compaction %.0f s ago dropped %i dead and %i duplicate handles and %i empty proxies."),
+		AllProxies.Num(),
+		Now - LastCompactionEndTime,
+		LastCompactionStats.NumDeadHandles,
+		LastCompactionStats.NumDuplicateHandles,
+		LastCompactionStats.NumEmptyProxiesDestroyed)
 }
 
 bool AAutoSupportModSubsystem::ShouldSave_Implementation() const
@@ -164,18 +1817,21 @@ void AAutoSupportModSubsystem::SetLastAutoSupport1mData(const FBuildableAutoSupp
 {
 	LastAutoSupport1mData = Data;
 	LastAutoSupportData = Data;
+	PreloadDescriptors(Data);
 }
 
 void AAutoSupportModSubsystem::SetLastAutoSupport2mData(const FBuildableAutoSupportData& Data)
 {
 	LastAutoSupport2mData = Data;
 	LastAutoSupportData = Data;
+	PreloadDescriptors(Data);
 }
 
 void AAutoSupportModSubsystem::SetLastAutoSupport4mData(const FBuildableAutoSupportData& Data)
 {
 	LastAutoSupport4mData = Data;
 	LastAutoSupportData = Data;
+	PreloadDescriptors(Data);
 }
 
 void AAutoSupportModSubsystem::GetAutoSupportPresetNames(TArray<FString>& OutNames) const
@@ -198,7 +1854,8 @@ bool AAutoSupportModSubsystem::GetAutoSupportPreset(FString PresetName, OUT FBui
 
 void AAutoSupportModSubsystem::SaveAutoSupportPreset(FString PresetName, FBuildableAutoSupportData Data)
 {
-	AutoSupportPresets.Add(PresetName, Data);
+	PreloadDescriptors(Data);
+	AutoSupportPresets.Add(PresetName, MoveTemp(Data));
 }
 
 void AAutoSupportModSubsystem::DeleteAutoSupportPreset(FString PresetName)
@@ -216,6 +1873,9 @@ bool AAutoSupportModSubsystem::IsExistingAutoSupportPreset(FString PresetName) c
 void AAutoSupportModSubsystem::RegisterProxy(ABuildableAutoSupportProxy* Proxy)
 {
 	AllProxies.Add(Proxy);
+	ProxyGrid.Update(Proxy, Proxy->GetWorldBounds());
+	UpdateProxyCollision(Proxy);
+	PendingRegisteredEvents.Add(Proxy);
 
 	if (const auto* GameInstance = GetWorld()->GetGameInstance())
 	{
@@ -241,4 +1901,6 @@ void AAutoSupportModSubsystem::RegisterHandleToProxyLink(const FAutoSupportBuild
 	}
 	
 	ProxyByBuildable.Add(Handle, Proxy);
+	HandlesByProxy.FindOrAdd(Proxy).Handles.Add(Handle);
+	AddToRemovalFilter(Handle);
 }
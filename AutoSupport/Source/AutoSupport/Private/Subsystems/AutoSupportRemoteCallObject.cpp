@@ -0,0 +1,36 @@
+﻿// 
+
+#include "AutoSupportRemoteCallObject.h"
+
+#include "BuildableAutoSupportRegion.h"
+#include "FGCharacterPlayer.h"
+#include "FGPlayerController.h"
+#include "ModLogging.h"
+#include "Net/UnrealNetwork.h"
+
+UAutoSupportRemoteCallObject* UAutoSupportRemoteCallObject::Get(const AFGCharacterPlayer* Player)
+{
+	auto* Controller = Player ? Cast<AFGPlayerController>(Player->GetController()) : nullptr;
+	
+	return Controller ? Cast<UAutoSupportRemoteCallObject>(Controller->GetRemoteCallObjectOfClass(StaticClass())) : nullptr;
+}
+
+void UAutoSupportRemoteCallObject::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UAutoSupportRemoteCallObject, bDummy);
+}
+
+void UAutoSupportRemoteCallObject::Server_DismantleRegionRecord_Implementation(ABuildableAutoSupportRegion* Region, const int32 RecordId)
+{
+	auto* Player = Cast<AFGCharacterPlayer>(GetOuterFGPlayerController()->GetPawn());
+
+	if (!IsValid(Region) || !Player)
+	{
+		MOD_LOG(Warning, TEXT("Region record dismantle requested without a region or player."))
+		return;
+	}
+
+	Region->DismantleRecord(RecordId, Player);
+}
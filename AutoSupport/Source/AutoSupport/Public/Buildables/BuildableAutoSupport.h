@@ -9,6 +9,9 @@
 #include "BuildableAutoSupport.generated.h"
 
 class ABuildableAutoSupportProxy;
+class ABuildableAutoSupportRegion;
+class AFGBlueprintProxy;
+class UBuildableAutoSupportPreviewComponent;
 class UFGBuildingDescriptor;
 
 UCLASS(Abstract, Blueprintable)
@@ -40,7 +43,48 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void BuildSupports(APawn* BuildInstigator);
 
+	/**
+	 * Traces, plans, and updates the build preview with the plan. Requires a preview to be requested.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Auto Support")
+	void RefreshBuildPreview();
+
+	/**
+	 * Requests the build preview to be shown. The preview is refreshed periodically until every request is removed.
+	 * @param PreviewInstigator Who the plan is created for.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Auto Support")
+	void AddBuildPreviewRequest(APawn* PreviewInstigator);
+
+	/**
+	 * Removes a build preview request. Hides the preview when no requests are left.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Auto Support")
+	void RemoveBuildPreviewRequest();
+
+	/**
+	 * The plan last created for the build preview.
+	 */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Auto Support")
+	FAutoSupportBuildPlan CachedPlan;
+
+	/**
+	 * The prepared build of the cached plan.
+	 */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Auto Support")
+	FAutoSupportPreparedBuild CachedPreparedBuild;
+
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+#pragma region IFGUseableInterface
+
+	virtual void StartIsLookedAt_Implementation(AFGCharacterPlayer* byCharacter, const FUseState& state) override;
+	virtual void StopIsLookedAt_Implementation(AFGCharacterPlayer* byCharacter, const FUseState& state) override;
+	virtual void RegisterInteractingPlayer_Implementation(AFGCharacterPlayer* player) override;
+	virtual void UnregisterInteractingPlayer_Implementation(AFGCharacterPlayer* player) override;
+
+#pragma endregion
 
 #pragma region IFGSaveInterface
 	
@@ -70,6 +114,54 @@ protected:
 	 */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Auto Support")
 	TSubclassOf<ABuildableAutoSupportProxy> AutoSupportProxyClass;
+
+	/**
+	 * The region actor class to use when supports are stored in regions. See UAutoSupportBuildConfigModule::bStoreSupportsInRegions.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Auto Support")
+	TSubclassOf<ABuildableAutoSupportRegion> AutoSupportRegionClass;
+
+	/**
+	 * Draws the preview of the planned supports.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Auto Support")
+	TObjectPtr<UBuildableAutoSupportPreviewComponent> PreviewComponent;
+
+	/**
+	 * How often, in seconds, the build preview is retraced while it is requested.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Auto Support")
+	float BuildPreviewRefreshInterval = 0.1f;
+
+	/**
+	 * The number of active build preview requests.
+	 */
+	int32 NumBuildPreviewRequests = 0;
+
+	/**
+	 * Who the build preview plan is created for.
+	 */
+	TWeakObjectPtr<APawn> BuildPreviewInstigator;
+
+	FTimerHandle BuildPreviewRefreshTimerHandle;
+
+	/**
+	 * The trace the build preview was last planned from. An unchanged trace over unchanged data gives the same plan, so the preview is only
+	 * planned and prepared again when either changed.
+	 */
+	FAutoSupportTraceResult PreviewTraceResult;
+
+	/**
+	 * The data the build preview was last planned with. See PreviewTraceResult.
+	 */
+	FBuildableAutoSupportData PreviewTraceData;
+
+	bool bHasPreviewTrace = false;
+	
+	/**
+	 * Asynchronously loads the configured part descriptors so planning never has to wait on them.
+	 */
+	void PreloadDescriptors();
 	
 	void AutoConfigure();
 
@@ -88,6 +180,59 @@ protected:
 	 */
 	FAutoSupportTraceResult Trace() const;
 
+	/**
+	 * Checks what can be checked before tracing, adding any disqualifier to the plan.
+	 * @return False if there is nothing to plan.
+	 */
+	bool CanCreatePlan(FAutoSupportBuildPlan& OutPlan) const;
+
+	/**
+	 * Plans the build from a trace and checks the instigator can afford it.
+	 * @return True if the plan is actionable.
+	 */
+	bool CreatePlanFromTrace(APawn* BuildInstigator, const FAutoSupportTraceResult& TraceResult, FAutoSupportBuildPlan& OutPlan) const;
+
+	/**
+	 * Sets or clears the unaffordable disqualifier of the plan for the instigator's inventory.
+	 */
+	static void UpdatePlanAffordability(APawn* BuildInstigator, FAutoSupportBuildPlan& Plan);
+
+	/**
+	 * @return True if the traces hit the same and would plan the same.
+	 */
+	static bool IsSameTrace(const FAutoSupportTraceResult& A, const FAutoSupportTraceResult& B);
+
+	/**
+	 * @return True if CachedPreparedBuild was prepared from a plan laid out the same as this one, at the same proxy transform. The preview
+	 * prepares the plan every refresh, so building can commit that instead of preparing it again.
+	 */
+	bool IsCachedPreparedBuildCurrent(const FAutoSupportBuildPlan& Plan, const FTransform& ProxyTransform) const;
+
+	/**
+	 * Spawns, constructs and registers the prepared parts. Must be called on the game thread.
+	 * @return The proxy containing the parts.
+	 */
+	ABuildableAutoSupportProxy* CommitPreparedBuild(const FAutoSupportPreparedBuild& Build, APawn* BuildInstigator);
+
+	/**
+	 * Spawns, constructs and registers a prepared build of exactly one part without a support proxy. Must be called on the game thread.
+	 * @return The built part.
+	 */
+	AFGBuildable* CommitPreparedSinglePart(const FAutoSupportPreparedBuild& Build, APawn* BuildInstigator);
+
+	/**
+	 * Spawns, constructs and registers the prepared parts as a record of the region of their cell instead of a support proxy. Must be called
+	 * on the game thread.
+	 * @return The region containing the record.
+	 */
+	ABuildableAutoSupportRegion* CommitPreparedBuildToRegion(const FAutoSupportPreparedBuild& Build, APawn* BuildInstigator);
+
+	/**
+	 * Adds a built part to the blueprint proxy this cube was built from, so it is saved and dismantled with the blueprint. A part built into
+	 * a support proxy stays registered there as well, see ABuildableAutoSupportProxy::BlueprintProxy.
+	 */
+	static void RegisterWithBlueprintProxy(AFGBlueprintProxy* BlueprintProxy, AFGBuildable* Buildable);
+
 	FVector GetCubeFaceRelativeLocation(EAutoSupportBuildDirection Direction) const;
 	
 	static FVector GetEndTraceWorldLocation(const FVector& StartLocation, const FVector& Direction, float MaxBuildDistance);
@@ -0,0 +1,77 @@
+﻿//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BuildableAutoSupport_Types.h"
+#include "Components/SceneComponent.h"
+#include "BuildableAutoSupportPreviewComponent.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+
+/**
+ * Draws a ghost of a planned support. Every part mesh is drawn as an instance of one instanced static mesh component per mesh so
+ * no holograms are spawned for the preview.
+ */
+UCLASS(ClassGroup = "AutoSupport", meta = (BlueprintSpawnableComponent))
+class AUTOSUPPORT_API UBuildableAutoSupportPreviewComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+	UBuildableAutoSupportPreviewComponent();
+
+	/**
+	 * Shows the parts in the preview. When the parts are unchanged, this is a no-op. Otherwise, only the instance transforms are
+	 * rewritten, adding or removing instances if the part counts changed.
+	 * @param Parts The planned parts, relative to the proxy transform.
+	 * @param ProxyTransform The world transform of the proxy the parts are relative to.
+	 */
+	void ShowParts(const TArray<FAutoSupportPlannedPart>& Parts, const FTransform& ProxyTransform);
+
+	/**
+	 * Removes all instances from the preview. The instance components are kept for reuse.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Auto Support")
+	void ClearPreview();
+
+	/**
+	 * The material to draw the preview with. If not set, the part mesh materials are used.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Auto Support")
+	TObjectPtr<UMaterialInterface> PreviewMaterial;
+
+	/**
+	 * If true, the instances are not drawn and only render to custom depth, so only an outline of the parts shows. Used to highlight built
+	 * lightweight parts without drawing over them.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Auto Support")
+	bool bOutlineOnly = false;
+
+protected:
+	/**
+	 * The instance components, one per part mesh.
+	 */
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UStaticMesh>, TObjectPtr<UInstancedStaticMeshComponent>> InstancesByMesh;
+
+	/**
+	 * The parts currently shown.
+	 */
+	UPROPERTY(Transient)
+	TArray<FAutoSupportPlannedPart> ShownParts;
+
+	/**
+	 * The proxy transform currently shown.
+	 */
+	UPROPERTY(Transient)
+	FTransform ShownProxyTransform;
+
+	UInstancedStaticMeshComponent* FindOrCreateInstances(UStaticMesh* Mesh);
+
+	bool IsShowing(const TArray<FAutoSupportPlannedPart>& Parts, const FTransform& ProxyTransform) const;
+
+	virtual void OnUnregister() override;
+};
@@ -10,10 +10,43 @@
 #include "GameFramework/Actor.h"
 #include "BuildableAutoSupportProxy.generated.h"
 
+class AFGBlueprintProxy;
+class UBuildableAutoSupportPreviewComponent;
 class UFGBuildGunModeDescriptor;
 class AFGBuildable;
 class UBoxComponent;
 
+/**
+ * What a proxy's bounding box does for the current build gun mode.
+ */
+UENUM(BlueprintType)
+enum class EAutoSupportProxyBuildModeState : uint8
+{
+	/**
+	 * No state applied yet.
+	 */
+	None,
+	
+	/**
+	 * Hidden and without collision, the parts are dismantled as regular buildables or not at all.
+	 */
+	Inactive,
+
+	/**
+	 * The bounding box can be aimed at to dismantle the whole support.
+	 */
+	Dismantle
+};
+
+/**
+ * The rotation and scale of a proxy part relative to the proxy.
+ */
+struct FAutoSupportProxyPartOrientation
+{
+	FQuat4f Rotation;
+	FVector3f Scale;
+};
+
 /**
  * Like AFGBlueprintProxy but for auto supports.
  * Blueprint needs to set up collider with build gun.
@@ -33,18 +66,158 @@ public:
 	bool bIsNewlySpawned = false;
 
 	void RegisterBuildable(AFGBuildable* Buildable);
-	void UnregisterBuildable(AFGBuildable* Buildable);
+
+	/**
+	 * Sets the blueprint proxy the parts were also registered with. See BlueprintProxy.
+	 */
+	FORCEINLINE void SetBlueprintProxy(AFGBlueprintProxy* InBlueprintProxy)
+	{
+		BlueprintProxy = InBlueprintProxy;
+	}
+
+	FORCEINLINE AFGBlueprintProxy* GetBlueprintProxy() const
+	{
+		return BlueprintProxy.Get();
+	}
+
+	/**
+	 * Marks the handle for removal. Removals are collected in a dismantle transaction and applied together when the subsystem commits it,
+	 * so dismantling a proxy part by part does not search the handles once per part.
+	 * @param Handle The registered handle, as keyed in the subsystem.
+	 */
+	void UnregisterHandle(const FAutoSupportBuildableHandle& Handle);
+
+	/**
+	 * Opens a dismantle transaction if one is not open already, and queues it to be committed by the subsystem.
+	 */
+	void BeginDismantleTransaction();
+
+	/**
+	 * Removes every handle marked for removal in one pass and closes the transaction. Called by the subsystem.
+	 * @param OutRemovedHandles The handles that were marked for removal, to unlink from the subsystem.
+	 */
+	void CommitDismantleTransaction(TArray<FAutoSupportBuildableHandle>& OutRemovedHandles);
+
+	FORCEINLINE bool IsInDismantleTransaction() const
+	{
+		return bIsInDismantleTransaction;
+	}
 
 	void UpdateBoundingBox(const FBox& NewBounds);
-	UFUNCTION(BlueprintImplementableEvent)
+	UFUNCTION(BlueprintImplementableEvent, meta = (DeprecatedFunction, DeprecationMessage = "The bounding box component is updated natively. Only called if implemented."))
 	void K2_UpdateBoundingBox(const FBox& NewBounds);
+
+	/**
+	 * @return The bounding box in world space.
+	 */
+	FBox GetWorldBounds() const;
+
+	FORCEINLINE const FBox& GetLocalBounds() const
+	{
+		return BoundingBox;
+	}
 	
+	/**
+	 * Applies the build mode state for the build mode. Only proxies in the proxy dismantle mode can be aimed at.
+	 */
 	void OnBuildModeUpdate(TSubclassOf<UFGBuildGunModeDescriptor> BuildMode, ULocalPlayer* LocalPlayer);
-	UFUNCTION(BlueprintImplementableEvent)
+
+	FORCEINLINE EAutoSupportProxyBuildModeState GetBuildModeState() const
+	{
+		return BuildModeState;
+	}
+
+	/**
+	 * @return True if the proxy was last updated with the build mode, so updating it again would do nothing.
+	 */
+	FORCEINLINE bool IsInBuildMode(const TSubclassOf<UFGBuildGunModeDescriptor> BuildMode) const
+	{
+		return bHasAppliedBuildMode && AppliedBuildMode == BuildMode;
+	}
+	
+	UFUNCTION(BlueprintImplementableEvent, meta = (DeprecatedFunction, DeprecationMessage = "Visibility and collision are applied natively from the build mode state. Only called if implemented."))
 	void K2_OnBuildModeUpdate(TSubclassOf<UFGBuildGunModeDescriptor> BuildMode, ULocalPlayer* LocalPlayer);
 	
 	bool DestroyIfEmpty(bool bRemoveInvalidHandles);
 
+	/**
+	 * Drops the dead handles and the duplicates of handles to the same buildable. Skipped while the proxy is being resolved, hovered or
+	 * dismantled. Called by the subsystem's compaction sweep.
+	 * @param OutDeadHandles The dropped dead handles, to unlink from the subsystem. Duplicates share their kept handle's link.
+	 * @param OutNumDuplicates The number of dropped duplicates.
+	 * @return False if skipped.
+	 */
+	bool CompactHandles(TArray<FAutoSupportBuildableHandle>& OutDeadHandles, int32& OutNumDuplicates);
+
+	/**
+	 * Outlines the parts for dismantle without spawning temporaries for the lightweight parts.
+	 */
+	void ShowDismantleHighlight(AFGCharacterPlayer* Player);
+	void HideDismantleHighlight(AFGCharacterPlayer* Player);
+
+	FORCEINLINE int32 GetNumParts() const
+	{
+		return PartClassIndices.Num();
+	}
+
+	/**
+	 * Makes the handle of the part. The handles are not stored, see PartClasses.
+	 */
+	FAutoSupportBuildableHandle MakeHandle(int32 PartIndex) const;
+
+	/**
+	 * Makes the handles of every part and appends them, root first.
+	 */
+	void AppendHandles(TArray<FAutoSupportBuildableHandle>& OutHandles) const;
+
+	/**
+	 * @return The index of the part the handle equals, or INDEX_NONE.
+	 */
+	int32 FindPartIndex(const FAutoSupportBuildableHandle& Handle) const;
+
+	/**
+	 * @return The part's buildable or lightweight temporary, or null if it has none right now.
+	 */
+	FORCEINLINE AFGBuildable* GetPartBuildable(const int32 PartIndex) const
+	{
+		return PartBuildables[PartIndex].Get();
+	}
+
+	/**
+	 * Links the loaded lightweight handles to their runtime instances, then registers with the subsystem. Called by the subsystem after load.
+	 * @param RefsByHandle The resolved instance refs of every queued proxy.
+	 */
+	void ResolveLightweightRefs(const TMap<FAutoSupportBuildableHandle, FLightweightBuildableInstanceRef>& RefsByHandle);
+
+	FORCEINLINE bool IsLoadResolvePending() const
+	{
+		return bIsLoadResolvePending;
+	}
+
+	/**
+	 * Resolves the proxy right away if it is still waiting its turn in the subsystem's load queue. For when it is interacted with.
+	 * @return False if resolving destroyed the proxy because none of its parts remain.
+	 */
+	bool EnsureLoadResolved();
+
+	/**
+	 * @return The valid lightweight ref of the handle, or null.
+	 */
+	const FLightweightBuildableInstanceRef* FindLightweightRef(const FAutoSupportBuildableHandle& Handle) const;
+
+	/**
+	 * Adds up the memory of the parts, for the memory report.
+	 * @param OutBytes The part layout and its lightweight refs, as held at runtime.
+	 * @param OutHandleBytes The same parts held as handles with the refs in a map keyed by handle, as they were held before.
+	 * @param OutSavedBytes The parts as encoded by FAutoSupportHandleCodec for the save. Not held at runtime, only for comparison.
+	 */
+	void GetHandleMemoryUsage(SIZE_T& OutBytes, SIZE_T& OutHandleBytes, SIZE_T& OutSavedBytes) const;
+
+	/**
+	 * Points a lightweight handle at the instance the auditor found for it.
+	 */
+	void RepairLightweightRef(const FAutoSupportBuildableHandle& Handle, const FLightweightBuildableInstanceRef& InstanceRef);
+
 #pragma region IFGSaveInterface
 	
 	virtual void GatherDependencies_Implementation(TArray<UObject*>& out_dependentObjects) override;
@@ -81,13 +254,101 @@ public:
 protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Auto Support")
 	TObjectPtr<UBoxComponent> BoundingBoxComponent;
+
+	/**
+	 * The collision profile of the bounding box in the dismantle state. If none, the profile set up on the component is kept. Unused when
+	 * the subsystem has a shared proxy collision class, the bounding box then never collides.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	FName DismantleCollisionProfileName;
+
+	/**
+	 * If true, the bounding box is drawn in the dismantle state.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	bool bShowBoundingBoxInDismantleState = false;
+
+	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = "Auto Support")
+	EAutoSupportProxyBuildModeState BuildModeState = EAutoSupportProxyBuildModeState::None;
+
+	/**
+	 * Whether the deprecated blueprint events are implemented, so they are only called into when needed.
+	 */
+	UPROPERTY(Transient)
+	bool bImplementsK2UpdateBoundingBox = false;
+	
+	UPROPERTY(Transient)
+	bool bImplementsK2OnBuildModeUpdate = false;
+
+	/**
+	 * Outlines the parts while hovered for dismantle, without spawning temporaries for the lightweight parts.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Auto Support")
+	TObjectPtr<UBuildableAutoSupportPreviewComponent> DismantleHighlightComponent;
 	
 	/**
-	 * The registered buildable handles.
+	 * The class table of the parts. The parts are held as a struct of arrays rather than as handles: per part, an index into this table, an
+	 * index into PartOrientations, the offset from the proxy quantized by FAutoSupportHandleCodec, the buildable and the lightweight ref.
+	 * The per-part arrays are parallel and the root part is first. Handles are made from them on demand, see MakeHandle.
 	 */
-	UPROPERTY(VisibleInstanceOnly, Category = "Auto Support", SaveGame)
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Auto Support")
+	TArray<TSubclassOf<AFGBuildable>> PartClasses;
+
+	/**
+	 * The orientation table of the parts. They mostly share the proxy's rotation, so there are few.
+	 */
+	TArray<FAutoSupportProxyPartOrientation> PartOrientations;
+
+	TArray<uint16> PartClassIndices;
+	TArray<uint16> PartOrientationIndices;
+
+	/**
+	 * The part offsets from the proxy, in FAutoSupportHandleCodec::OffsetQuantum steps.
+	 */
+	TArray<FIntVector> PartOffsets;
+
+	/**
+	 * The part buildables. For lightweight parts, the temporary while one is spawned.
+	 */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Auto Support")
+	TArray<TWeakObjectPtr<AFGBuildable>> PartBuildables;
+
+	/**
+	 * Legacy save storage of the handles. Only read to migrate older saves, it's saved empty.
+	 */
+	UPROPERTY(SaveGame)
 	TArray<FAutoSupportBuildableHandle> RegisteredHandles;
 
+	/**
+	 * The class table of the saved handles.
+	 */
+	UPROPERTY(SaveGame)
+	TArray<TSubclassOf<AFGBuildable>> SavedHandleClasses;
+
+	/**
+	 * The non-lightweight buildables of the saved handles.
+	 */
+	UPROPERTY(SaveGame)
+	TArray<TWeakObjectPtr<AFGBuildable>> SavedHandleBuildables;
+
+	/**
+	 * The saved handles, compactly encoded by FAutoSupportHandleCodec.
+	 */
+	UPROPERTY(SaveGame)
+	TArray<uint8> SavedHandleData;
+
+	/**
+	 * The blueprint proxy the parts also belong to, when the cube that built them was placed from a blueprint. Each part is then owned by
+	 * both proxies and either side can dismantle it:
+	 * - Dismantling the blueprint refunds and removes the parts. Their handles are unlinked here on removal, or by the next compaction sweep
+	 *   for instances removed without a temporary, and the emptied proxy is destroyed, not dismantled, so nothing is refunded twice.
+	 * - Dismantling this proxy refunds the parts from the handles and dismantles them. A dismantled part is unregistered from the blueprint
+	 *   proxy by the game without a refund of its own.
+	 * Selecting both in one dismantle would refund the parts from both, so that is disqualified.
+	 */
+	UPROPERTY(SaveGame)
+	TWeakObjectPtr<AFGBlueprintProxy> BlueprintProxy;
+
 	/**
 	 * The bounding box of the buildable.
 	 */
@@ -97,42 +358,93 @@ protected:
 	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = "Auto Support")
 	bool bIsHoveredForDismantle = false;
 
+	/**
+	 * The build mode the proxy was last updated with. See bHasAppliedBuildMode, null is a valid mode.
+	 */
+	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = "Auto Support")
+	TSubclassOf<UFGBuildGunModeDescriptor> AppliedBuildMode;
+
+	UPROPERTY(Transient)
+	bool bHasAppliedBuildMode = false;
+
 	/**
 	 * Transient flag that tracks when all buildables & temporaries are available.
 	 */
 	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = "Auto Support")
 	bool bBuildablesAvailable = false;
 	
+	/**
+	 * Transient flag that is true from load until the subsystem resolves the lightweight handles.
+	 */
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "Auto Support")
-	bool bIsLoadTraceInProgress = false;
+	bool bIsLoadResolvePending = false;
 
-	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = "Auto Support")
-	TMap<FAutoSupportBuildableHandle, FLightweightBuildableInstanceRef> LightweightRefsByHandle;
-	
-	FOverlapDelegate LoadTraceDelegate;
+	/**
+	 * The lightweight ref of each part, by part index. Invalid for parts that are actors, and until the load resolve.
+	 */
+	UPROPERTY(Transient, VisibleInstanceOnly, Category = "Auto Support")
+	TArray<FLightweightBuildableInstanceRef> LightweightRefs;
+
+	/**
+	 * Transient flag that is true while handle removals are being collected. See UnregisterHandle.
+	 */
+	UPROPERTY(Transient, VisibleInstanceOnly, Category = "Auto Support")
+	bool bIsInDismantleTransaction = false;
+
+	/**
+	 * The handles marked for removal in the open dismantle transaction.
+	 */
+	UPROPERTY(Transient)
+	TSet<FAutoSupportBuildableHandle> PendingRemovedHandles;
 
 	virtual void BeginPlay() override;
 
-	FORCEINLINE const FAutoSupportBuildableHandle* GetRootHandle() const
+	FORCEINLINE AFGBuildable* GetRootBuildable() const
 	{
-		return RegisteredHandles.Num() > 0 ? &RegisteredHandles[0] : nullptr;
+		return PartBuildables.Num() > 0 ? PartBuildables[0].Get() : nullptr;
 	}
 
 	FORCEINLINE AFGBuildable* GetCheckedRootBuildable() const
 	{
-		auto* RootHandle = GetRootHandle();
-		fgcheck(RootHandle);
-		fgcheck(RootHandle->Buildable.IsValid());
-		return RootHandle->Buildable.Get();
+		auto* RootBuildable = GetRootBuildable();
+		fgcheck(RootBuildable);
+		return RootBuildable;
 	}
 
+	virtual void PostInitializeComponents() override;
+	
+	void SetBuildModeState(EAutoSupportProxyBuildModeState NewState);
+	
 	void EnsureBuildablesAvailable();
 	void RemoveTemporaries(AFGCharacterPlayer* Player);
 	void RemoveInvalidHandles();
 	void RegisterSelfAndHandlesWithSubsystem();
 
-	void BeginLoadTrace();
-	void OnLoadTraceComplete(const FTraceHandle& Handle, FOverlapDatum& Datum);
+	const FLightweightBuildableInstanceRef* FindLightweightRefAt(int32 PartIndex) const;
+
+	/**
+	 * Adds a part to the layout.
+	 * @return The part index, or INDEX_NONE if the class or orientation table is full.
+	 */
+	int32 AddPart(TSubclassOf<AFGBuildable> BuildableClass, const FTransform& Transform, const TWeakObjectPtr<AFGBuildable>& Buildable);
+
+	/**
+	 * Clears the layout and adds the parts of the handles.
+	 */
+	void SetParts(const TArray<FAutoSupportBuildableHandle>& NewHandles);
+
+	FTransform GetPartRelativeTransform(int32 PartIndex) const;
+
+	/**
+	 * MakeHandle for when the proxy transform is already at hand, to make many.
+	 */
+	FAutoSupportBuildableHandle MakeHandle(int32 PartIndex, const FTransform& ProxyTransform) const;
+
+	/**
+	 * Removes the parts at the indices the predicate returns true for. Keeps the order, the root part has to stay first.
+	 * @return The number of removed parts.
+	 */
+	int32 RemovePartsWhere(TFunctionRef<bool(int32 PartIndex)> Predicate);
 	
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 };
@@ -0,0 +1,91 @@
+﻿//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "BuildableAutoSupportProxyCollision.generated.h"
+
+class ABuildableAutoSupportProxy;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+/**
+ * The shared dismantle collision of the proxies in one cell of the region grid. Each proxy has one box instance instead of a collision body
+ * of its own, so the physics scene holds a body per cell rather than per proxy. Transient, the subsystem rebuilds it from the proxies.
+ */
+UCLASS(Blueprintable, NotPlaceable)
+class AUTOSUPPORT_API ABuildableAutoSupportProxyCollision : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ABuildableAutoSupportProxyCollision();
+
+	/**
+	 * Adds the proxy's instance, or moves it to the proxy's current bounds.
+	 */
+	void AddOrUpdateProxy(ABuildableAutoSupportProxy* Proxy);
+
+	void RemoveProxy(const ABuildableAutoSupportProxy* Proxy);
+
+	/**
+	 * @return The proxy of the collision instance, or null.
+	 */
+	ABuildableAutoSupportProxy* FindProxyByInstance(int32 InstanceIndex) const;
+
+	/**
+	 * Enables the instance collision. Only enabled while a player is in the proxy dismantle mode.
+	 */
+	void SetCollisionActive(bool bActive);
+
+	FORCEINLINE int32 NumProxies() const
+	{
+		return InstanceProxies.Num();
+	}
+
+	FORCEINLINE UInstancedStaticMeshComponent* GetInstanceCollisionComponent() const
+	{
+		return InstanceCollisionComponent;
+	}
+
+protected:
+	/**
+	 * One box instance per proxy, in InstanceProxies order.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Auto Support")
+	TObjectPtr<UInstancedStaticMeshComponent> InstanceCollisionComponent;
+
+	/**
+	 * The mesh of the instances. Expected to be a box, scaled to each proxy's bounds.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	TObjectPtr<UStaticMesh> CollisionMesh;
+
+	/**
+	 * The half size of CollisionMesh, used to scale the instances to the proxy bounds.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	FVector CollisionMeshExtent = FVector(50.f);
+
+	/**
+	 * The collision profile while active. If none, the profile set up on the component is kept.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	FName DismantleCollisionProfileName;
+
+	/**
+	 * The proxy of each instance, by instance index.
+	 */
+	UPROPERTY(Transient, VisibleInstanceOnly, Category = "Auto Support")
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> InstanceProxies;
+
+	/**
+	 * The instance index by proxy.
+	 */
+	TMap<TWeakObjectPtr<const ABuildableAutoSupportProxy>, int32> InstanceByProxy;
+
+	virtual void BeginPlay() override;
+
+	FTransform GetInstanceTransform(const ABuildableAutoSupportProxy* Proxy) const;
+};
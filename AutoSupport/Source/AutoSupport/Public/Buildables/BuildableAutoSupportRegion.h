@@ -0,0 +1,265 @@
+﻿//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGDismantleInterface.h"
+#include "FGSaveInterface.h"
+#include "ModTypes.h"
+#include "GameFramework/Actor.h"
+#include "BuildableAutoSupportRegion.generated.h"
+
+class ABuildableAutoSupportRegion;
+class AFGBuildable;
+class AFGCharacterPlayer;
+class UBuildableAutoSupportPreviewComponent;
+class UFGBuildGunModeDescriptor;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+/**
+ * A support stored in a region. The compact counterpart of a support proxy.
+ */
+USTRUCT()
+struct AUTOSUPPORT_API FAutoSupportRegionRecord
+{
+	GENERATED_BODY()
+
+	/**
+	 * Identifies the record within its region. Stable across saves, unlike the record index.
+	 */
+	UPROPERTY(SaveGame)
+	int32 RecordId = INDEX_NONE;
+
+	/**
+	 * The world transform the support was built relative to.
+	 */
+	UPROPERTY(SaveGame)
+	FTransform Transform;
+
+	/**
+	 * The bounds of the support relative to Transform.
+	 */
+	UPROPERTY(SaveGame)
+	FBox LocalBounds = FBox(ForceInit);
+
+	UPROPERTY(Transient)
+	TArray<FAutoSupportBuildableHandle> Handles;
+
+	/**
+	 * The handles, compactly encoded by FAutoSupportHandleCodec. Only set while saving and loading.
+	 */
+	UPROPERTY(SaveGame)
+	TArray<TSubclassOf<AFGBuildable>> SavedHandleClasses;
+
+	UPROPERTY(SaveGame)
+	TArray<TWeakObjectPtr<AFGBuildable>> SavedHandleBuildables;
+
+	UPROPERTY(SaveGame)
+	TArray<uint8> SavedHandleData;
+
+	FORCEINLINE FBox GetWorldBounds() const
+	{
+		return LocalBounds.TransformBy(Transform);
+	}
+};
+
+/**
+ * Where a handle lives in the regions.
+ */
+USTRUCT()
+struct AUTOSUPPORT_API FAutoSupportRegionRecordRef
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TWeakObjectPtr<ABuildableAutoSupportRegion> Region;
+
+	UPROPERTY()
+	int32 RecordId = INDEX_NONE;
+};
+
+/**
+ * Holds the supports built in one cell of the region grid as compact records, instead of one support proxy actor each. Every record has an
+ * instance in one collision component, so the build gun can aim at the region. The record itself is resolved on the client by tracing the
+ * record bounds, and the client sends that record id to the server to dismantle, see DismantleRecord.
+ */
+UCLASS(Blueprintable)
+class AUTOSUPPORT_API ABuildableAutoSupportRegion : public AActor, public IFGDismantleInterface, public IFGSaveInterface
+{
+	GENERATED_BODY()
+
+public:
+	ABuildableAutoSupportRegion();
+
+	/**
+	 * @return The region grid cell of the location.
+	 */
+	static FIntVector GetRegionCell(const FVector& Location);
+
+	/**
+	 * @return The world location of the center of the region grid cell.
+	 */
+	static FVector GetRegionCellCenter(const FIntVector& Cell);
+
+	FORCEINLINE const FIntVector& GetCell() const
+	{
+		return Cell;
+	}
+
+	FORCEINLINE void SetCell(const FIntVector& NewCell)
+	{
+		Cell = NewCell;
+	}
+
+	FORCEINLINE int32 NumRecords() const
+	{
+		return Records.Num();
+	}
+
+	/**
+	 * Adds a support as a record.
+	 * @return The record id.
+	 */
+	int32 AddRecord(const FTransform& SupportTransform, const FBox& LocalBounds, const TArray<AFGBuildable*>& Buildables);
+
+	/**
+	 * Removes the record and unlinks its handles from the subsystem. Destroys the region once it holds no records.
+	 */
+	void RemoveRecord(int32 RecordId);
+
+	/**
+	 * Removes one handle of a record whose part was removed from the world. The record is removed once it has no handles left.
+	 */
+	void UnregisterRecordHandle(int32 RecordId, const FAutoSupportBuildableHandle& Handle);
+
+	const FAutoSupportRegionRecord* FindRecord(int32 RecordId) const;
+
+	/**
+	 * @return The record of the collision instance, or null.
+	 */
+	const FAutoSupportRegionRecord* FindRecordByCollisionInstance(int32 InstanceIndex) const;
+
+	/**
+	 * Finds the record whose bounds the segment passes through first. Tests the record bounds rather than the collision instances, which only
+	 * collide where a local player is in the proxy dismantle mode.
+	 * @return The record id, or INDEX_NONE.
+	 */
+	int32 TraceRecord(const FVector& Start, const FVector& End) const;
+
+	/**
+	 * Sets the record the player aims at, to highlight. Set by the build gun from the player's own trace. Only kept for local players.
+	 */
+	void SetAimedRecord(int32 RecordId, AFGCharacterPlayer* Player);
+
+	/**
+	 * @return The record id the local player aims at, or INDEX_NONE.
+	 */
+	int32 GetAimedRecord(const AFGCharacterPlayer* Player) const;
+
+	/**
+	 * Dismantles one record and gives its refund to the player. The refund is summed from the same record before its parts are dismantled.
+	 * Needs authority. Requested by the client through UAutoSupportRemoteCallObject with the record the player aimed at.
+	 */
+	void DismantleRecord(int32 RecordId, AFGCharacterPlayer* Player);
+
+	FORCEINLINE UInstancedStaticMeshComponent* GetRecordCollisionComponent() const
+	{
+		return RecordCollisionComponent;
+	}
+
+	void OnBuildModeUpdate(TSubclassOf<UFGBuildGunModeDescriptor> BuildMode);
+
+#pragma region IFGSaveInterface
+
+	virtual bool NeedTransform_Implementation() override;
+	virtual bool ShouldSave_Implementation() const override;
+	virtual void PreSaveGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+	virtual void PostSaveGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+	virtual void PostLoadGame_Implementation(int32 saveVersion, int32 gameVersion) override;
+
+#pragma endregion
+
+#pragma region IFGDismantleInterface
+
+	virtual bool CanDismantle_Implementation() const override;
+	virtual void Dismantle_Implementation() override;
+	virtual void GetChildDismantleActors_Implementation(TArray<AActor*>& out_ChildDismantleActors) const override;
+	virtual void GetDismantleDependencies_Implementation(TArray<AActor*>& out_dismantleDependencies) const override;
+	virtual void GetDismantleDisqualifiers_Implementation(
+		TArray<TSubclassOf<UFGConstructDisqualifier>>& out_dismantleDisqualifiers,
+		const TArray<AActor*>& allSelectedActors) const override;
+	virtual void GetDismantleRefund_Implementation(TArray<FInventoryStack>& out_refund, bool noBuildCostEnabled) const override;
+	virtual FVector GetRefundSpawnLocationAndArea_Implementation(const FVector& aimHitLocation, float& out_radius) const override;
+	virtual void PreUpgrade_Implementation() override;
+	virtual bool ShouldBlockDismantleSample_Implementation() const override;
+	virtual bool SupportsDismantleDisqualifiers_Implementation() const override;
+	virtual void Upgrade_Implementation(AActor* newActor) override;
+	virtual FText GetDismantleDisplayName_Implementation(AFGCharacterPlayer* byCharacter) const override;
+	virtual void StartIsLookedAtForDismantle_Implementation(AFGCharacterPlayer* byCharacter) override;
+	virtual void StopIsLookedAtForDismantle_Implementation(AFGCharacterPlayer* byCharacter) override;
+
+#pragma endregion
+
+protected:
+	/**
+	 * One box instance per record, in record order. Only collides in the proxy dismantle mode.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Auto Support")
+	TObjectPtr<UInstancedStaticMeshComponent> RecordCollisionComponent;
+
+	/**
+	 * Outlines the aimed at record's parts, one component per local player aiming at the region. Created on demand.
+	 */
+	UPROPERTY(Transient)
+	TMap<TWeakObjectPtr<AFGCharacterPlayer>, TObjectPtr<UBuildableAutoSupportPreviewComponent>> DismantleHighlightByPlayer;
+
+	/**
+	 * The mesh of the record collision instances. Expected to be a box, scaled to each record's bounds.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	TObjectPtr<UStaticMesh> RecordCollisionMesh;
+
+	/**
+	 * The half size of RecordCollisionMesh, used to scale the instances to the record bounds.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	FVector RecordCollisionMeshExtent = FVector(50.f);
+
+	/**
+	 * The region grid cell.
+	 */
+	UPROPERTY(SaveGame, VisibleInstanceOnly, Category = "Auto Support")
+	FIntVector Cell;
+
+	UPROPERTY(SaveGame, VisibleInstanceOnly, Category = "Auto Support")
+	TArray<FAutoSupportRegionRecord> Records;
+
+	UPROPERTY(SaveGame)
+	int32 NextRecordId = 0;
+
+	/**
+	 * The record index by record id.
+	 */
+	TMap<int32, int32> RecordIndexById;
+
+	/**
+	 * The record each local player aims at, from that player's own trace. Drives the highlight and the refund shown before dismantling. The
+	 * dismantle itself is sent to the server with the record id, see DismantleRecord.
+	 */
+	TMap<TWeakObjectPtr<AFGCharacterPlayer>, int32> AimedRecordByPlayer;
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	FTransform GetCollisionInstanceTransform(const FAutoSupportRegionRecord& Record) const;
+	void RebuildRecordIndex();
+	void RebuildCollisionInstances();
+	void RemoveRecordAt(int32 RecordIndex);
+	void ShowAimedRecordHighlight(AFGCharacterPlayer* Player);
+
+	/**
+	 * @return The record a local player aims at, or null. What the dismantle interface shows, the build gun only ticks for local players.
+	 */
+	const FAutoSupportRegionRecord* FindLocallyAimedRecord() const;
+};
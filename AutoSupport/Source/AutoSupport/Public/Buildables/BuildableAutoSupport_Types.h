@@ -82,6 +82,32 @@ struct AUTOSUPPORT_API FBuildableAutoSupportData
 	UPROPERTY(SaveGame, BlueprintReadWrite)
 	bool OnlyIntersectTerrain = false;
 
+	/**
+	 * Gathers the paths of every descriptor referenced. Unset descriptors are skipped.
+	 */
+	void GetDescriptorPaths(TArray<FSoftObjectPath>& OutPaths) const
+	{
+		for (const auto* Descriptor : { &StartPartDescriptor, &MiddlePartDescriptor, &EndPartDescriptor })
+		{
+			if (!Descriptor->IsNull())
+			{
+				OutPaths.AddUnique(Descriptor->ToSoftObjectPath());
+			}
+		}
+	}
+
+	/**
+	 * @return True if a referenced descriptor is set but not loaded yet.
+	 */
+	FORCEINLINE bool HasPendingDescriptors() const
+	{
+		return IsPending(StartPartDescriptor) || IsPending(MiddlePartDescriptor) || IsPending(EndPartDescriptor);
+	}
+
+	/**
+	 * Clears references to descriptors that are not loaded. Only call this once the descriptors have finished loading, otherwise
+	 * references still loading are lost.
+	 */
 	void ClearInvalidReferences()
 	{
 		if (!StartPartDescriptor.IsValid())
@@ -117,6 +143,12 @@ struct AUTOSUPPORT_API FBuildableAutoSupportData
 		
 		return Ar;
 	}
+
+private:
+	static FORCEINLINE bool IsPending(const TSoftClassPtr<UFGBuildingDescriptor>& Descriptor)
+	{
+		return !Descriptor.IsNull() && !Descriptor.IsValid();
+	}
 };
 
 USTRUCT(BlueprintType)
@@ -228,6 +260,77 @@ struct AUTOSUPPORT_API FAutoSupportBuildPlanPartData
 	}
 };
 
+USTRUCT(BlueprintType)
+struct AUTOSUPPORT_API FAutoSupportPlannedPart
+{
+	GENERATED_BODY()
+
+	/**
+	 * The class of the part.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	TSubclassOf<AFGBuildable> BuildableClass = nullptr;
+
+	/**
+	 * The recipe used when building.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	TSubclassOf<UFGRecipe> BuildRecipeClass = nullptr;
+
+	/**
+	 * The customization to apply.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	FFactoryCustomizationData CustomizationData;
+
+	/**
+	 * The transform of the part relative to the support proxy.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	FTransform RelativeTransform;
+
+	/**
+	 * @return True if the other part is the same buildable at the same place. Recipe and customization are not compared.
+	 */
+	FORCEINLINE bool Equals(const FAutoSupportPlannedPart& Other) const
+	{
+		return BuildableClass == Other.BuildableClass && RelativeTransform.Equals(Other.RelativeTransform);
+	}
+};
+
+/**
+ * Everything needed to construct a build plan, laid out flat. Preparing one does not touch the world, so it can be done off the game thread
+ * or cached with the plan, leaving only the spawning to the game thread.
+ */
+USTRUCT(BlueprintType)
+struct AUTOSUPPORT_API FAutoSupportPreparedBuild
+{
+	GENERATED_BODY()
+
+	/**
+	 * The world transform of the support proxy.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	FTransform ProxyTransform;
+
+	/**
+	 * The parts to build, in build order.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FAutoSupportPlannedPart> Parts;
+
+	/**
+	 * The bounds of all the parts, relative to the support proxy.
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	FBox LocalBounds = FBox(ForceInit);
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return Parts.IsEmpty();
+	}
+};
+
 USTRUCT(BlueprintType)
 struct AUTOSUPPORT_API FAutoSupportBuildPlan
 {
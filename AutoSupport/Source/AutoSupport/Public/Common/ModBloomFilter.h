@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A bloom filter over 64 bit keys, sized for an expected number of keys. Answers "definitely not added" or "maybe added". Keys cannot be
+ * removed; reset the filter and add the live keys again instead. Past its capacity the false positive rate climbs quickly, see
+ * IsOverCapacity.
+ */
+template <int32 NumHashes = 3>
+class TAutoSupportBloomFilter
+{
+	static_assert(NumHashes >= 1 && NumHashes <= 8, "Bloom filter hash count out of range.");
+	
+public:
+	/**
+	 * At 16 to 32 bits per key and 3 hashes the false positive rate stays under half a percent.
+	 */
+	static constexpr int32 BitsPerKey = 16;
+	static constexpr int32 MinNumBitsLog2 = 12;
+	static constexpr int32 MaxNumBitsLog2 = 28;
+	
+	TAutoSupportBloomFilter()
+	{
+		Reset(0);
+	}
+
+	void Add(const uint64 Key)
+	{
+		uint32 Indexes[NumHashes];
+		GetBitIndexes(Key, Indexes);
+
+		for (const auto Index : Indexes)
+		{
+			Words[Index >> 6] |= 1ull << (Index & 63);
+		}
+
+		++NumAdded;
+	}
+
+	bool MayContain(const uint64 Key) const
+	{
+		uint32 Indexes[NumHashes];
+		GetBitIndexes(Key, Indexes);
+
+		for (const auto Index : Indexes)
+		{
+			if ((Words[Index >> 6] & 1ull << (Index & 63)) == 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Clears the filter and sizes it for the expected number of keys.
+	 */
+	void Reset(const int32 ExpectedNumKeys)
+	{
+		const auto NumBitsWanted = static_cast<uint64>(FMath::Max(ExpectedNumKeys, 1)) * BitsPerKey;
+		NumBitsLog2 = FMath::Clamp(static_cast<int32>(FMath::CeilLogTwo64(NumBitsWanted)), MinNumBitsLog2, MaxNumBitsLog2);
+		Words.Init(0, GetNumBits() / 64);
+		NumAdded = 0;
+	}
+
+	FORCEINLINE uint32 GetNumBits() const
+	{
+		return 1u << NumBitsLog2;
+	}
+
+	/**
+	 * @return The number of keys the filter was sized for.
+	 */
+	FORCEINLINE int32 GetCapacity() const
+	{
+		return static_cast<int32>(GetNumBits() / BitsPerKey);
+	}
+
+	/**
+	 * @return True once more keys were added than the filter was sized for. Time to reset it to a larger size.
+	 */
+	FORCEINLINE bool IsOverCapacity() const
+	{
+		return NumAdded > GetCapacity();
+	}
+
+	/**
+	 * @return The number of keys added since the last reset, counting duplicates.
+	 */
+	FORCEINLINE int32 GetNumAdded() const
+	{
+		return NumAdded;
+	}
+
+private:
+	TArray<uint64> Words;
+	int32 NumBitsLog2 = MinNumBitsLog2;
+	int32 NumAdded = 0;
+
+	// Double hashing off one 64 bit mix of the key, see Kirsch and Mitzenmacher.
+	void GetBitIndexes(const uint64 Key, uint32 (&OutIndexes)[NumHashes]) const
+	{
+		auto Mixed = Key + 0x9e3779b97f4a7c15ull;
+		Mixed = (Mixed ^ (Mixed >> 30)) * 0xbf58476d1ce4e5b9ull;
+		Mixed = (Mixed ^ (Mixed >> 27)) * 0x94d049bb133111ebull;
+		Mixed ^= Mixed >> 31;
+
+		const auto HashA = static_cast<uint32>(Mixed);
+		const auto HashB = static_cast<uint32>(Mixed >> 32) | 1;
+
+		for (auto i = 0; i < NumHashes; ++i)
+		{
+			OutIndexes[i] = (HashA + i * HashB) & (GetNumBits() - 1);
+		}
+	}
+};
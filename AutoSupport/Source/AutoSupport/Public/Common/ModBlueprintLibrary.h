@@ -59,6 +59,44 @@ public:
 		AActor* Owner,
 		ABuildableAutoSupportProxy*& OutProxy);
 
+	/**
+	 * Spawns the support proxy and a composite hologram of the prepared parts. Only spawns; all the layout work is done by PrepareBuild.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "AutoSupport")
+	static AFGHologram* CreateCompositeHologramFromPreparedBuild(
+		const FAutoSupportPreparedBuild& Build,
+		TSubclassOf<ABuildableAutoSupportProxy> ProxyClass,
+		APawn* BuildInstigator,
+		AActor* Owner,
+		ABuildableAutoSupportProxy*& OutProxy);
+
+	/**
+	 * Spawns a composite hologram of the prepared parts in world space, without a support proxy. Used to build supports into a region.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "AutoSupport")
+	static AFGHologram* CreateWorldCompositeHologramFromPreparedBuild(
+		const FAutoSupportPreparedBuild& Build,
+		APawn* BuildInstigator,
+		AActor* Owner);
+
+	/**
+	 * @param Plan The plan.
+	 * @param Parent The actor the plan was made for.
+	 * @return The world transform of the support proxy that the plan's parts are built relative to.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "AutoSupport")
+	static FTransform GetPlanProxyTransform(const FAutoSupportBuildPlan& Plan, const AActor* Parent);
+
+	/**
+	 * Lays out every part the plan would build, in build order, relative to the support proxy. Does not touch the world, so it is safe to
+	 * call off the game thread.
+	 * @param Plan The plan.
+	 * @param ProxyTransform The world transform of the support proxy. See GetPlanProxyTransform.
+	 * @param OutBuild The prepared build.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "AutoSupport")
+	static void PrepareBuild(const FAutoSupportBuildPlan& Plan, const FTransform& ProxyTransform, FAutoSupportPreparedBuild& OutBuild);
+
 	UFUNCTION(BlueprintCallable, Category = "AutoSupport")
 	static bool IsPlanActionable(const FAutoSupportBuildPlan& Plan);
 
@@ -123,15 +161,11 @@ public:
 	
 private:
 	
-	static void SpawnPartPlanHolograms(
-		AFGHologram*& ParentHologram,
+	static void PreparePartPlan(
 		const FAutoSupportBuildPlanPartData& PartPlan,
-		APawn* BuildInstigator,
-		AActor* Parent,
-		AActor* Owner,
-		FTransform& WorkingTransform,
-		FBox& WorkingBBox);
-	
+		FVector& WorkingLocation,
+		FAutoSupportPreparedBuild& OutBuild);
+
 	static bool InitializePartPlan(
 		TSubclassOf<UFGBuildingDescriptor> PartDescriptorClass,
 		EAutoSupportBuildDirection PartOrientation,
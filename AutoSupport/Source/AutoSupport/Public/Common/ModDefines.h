@@ -11,4 +11,16 @@
 #endif
 
 #define AUTOSUPPORT_BUILD_SPACE_TOLERANCE 1.f
-#define AUTOSUPPORT_TRANSFORM_EQUALITY_TOLERANCE 0.01f
\ No newline at end of file
+#define AUTOSUPPORT_TRANSFORM_EQUALITY_TOLERANCE 0.01f
+#define AUTOSUPPORT_HANDLE_GRID_SIZE 0.5
+#define AUTOSUPPORT_PROXY_GRID_CELL_SIZE 3200.0
+#define AUTOSUPPORT_BUILD_MODE_IMMEDIATE_UPDATE_RADIUS 10000.0
+#define AUTOSUPPORT_BUILD_MODE_UPDATES_PER_FRAME 200
+#define AUTOSUPPORT_REGION_CELL_SIZE 25600.0
+#define AUTOSUPPORT_COMPACTION_PROXIES_PER_FRAME 50
+#define AUTOSUPPORT_COMPACTION_SWEEP_INTERVAL 60.0
+#define AUTOSUPPORT_COMPACTION_SAVE_LEAD 10.0
+#define AUTOSUPPORT_AUDIT_HANDLES_PER_FRAME 200
+#define AUTOSUPPORT_AUDIT_INTERVAL 300.0
+#define AUTOSUPPORT_LOAD_RESOLVE_PROXIES_PER_FRAME 100
+#define AUTOSUPPORT_LOAD_RESOLVE_IMMEDIATE_RADIUS 10000.0
@@ -26,3 +26,13 @@ class AUTOSUPPORT_API UAutoSupportConstructDisqualifier_InvalidPart : public UFG
 	}
 };
 
+UCLASS()
+class AUTOSUPPORT_API UAutoSupportConstructDisqualifier_OwnedBySelectedBlueprint : public UFGConstructDisqualifier
+{
+	GENERATED_BODY()
+
+	UAutoSupportConstructDisqualifier_OwnedBySelectedBlueprint()
+	{
+		mDisqfualifyingText = NSLOCTEXT("FAutoSupportModule", "OwnedBySelectedBlueprint", "The supports are part of a selected blueprint.");
+	}
+};
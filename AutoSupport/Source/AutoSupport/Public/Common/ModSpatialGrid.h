@@ -0,0 +1,243 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A uniform grid of world bounding boxes. Each element is stored in every cell its box overlaps, so box, radius and ray queries only visit
+ * the cells they touch. Elements must be hashable.
+ */
+template <typename ElementType>
+class TAutoSupportSpatialGrid
+{
+public:
+	explicit TAutoSupportSpatialGrid(const double InCellSize)
+		: CellSize(InCellSize)
+	{
+		check(CellSize > 0);
+	}
+
+	/**
+	 * Adds the element, or moves it if it was already added.
+	 */
+	void Update(const ElementType& Element, const FBox& Bounds)
+	{
+		const auto MinCell = GetCell(Bounds.Min);
+		const auto MaxCell = GetCell(Bounds.Max);
+
+		if (auto* Entry = Entries.Find(Element))
+		{
+			if (Entry->MinCell == MinCell && Entry->MaxCell == MaxCell)
+			{
+				Entry->Bounds = Bounds;
+				return;
+			}
+
+			RemoveFromCells(Element, *Entry);
+		}
+
+		auto& Entry = Entries.Add(Element, FEntry{ Bounds, MinCell, MaxCell });
+
+		ForEachCell(Entry.MinCell, Entry.MaxCell, [&](const FIntVector& Cell)
+		{
+			Cells.FindOrAdd(Cell).Add(Element);
+		});
+	}
+
+	void Remove(const ElementType& Element)
+	{
+		if (FEntry Entry; Entries.RemoveAndCopyValue(Element, Entry))
+		{
+			RemoveFromCells(Element, Entry);
+		}
+	}
+
+	void Reset()
+	{
+		Entries.Reset();
+		Cells.Reset();
+	}
+
+	FORCEINLINE int32 Num() const
+	{
+		return Entries.Num();
+	}
+
+	FORCEINLINE int32 NumCells() const
+	{
+		return Cells.Num();
+	}
+
+	void QueryBox(const FBox& Box, TArray<ElementType>& OutElements) const
+	{
+		TSet<ElementType> Visited;
+
+		ForEachCell(GetCell(Box.Min), GetCell(Box.Max), [&](const FIntVector& Cell)
+		{
+			VisitCell(Cell, Visited, OutElements, [&](const FBox& Bounds)
+			{
+				return Bounds.Intersect(Box);
+			});
+		});
+	}
+
+	void QueryRadius(const FVector& Center, const double Radius, TArray<ElementType>& OutElements) const
+	{
+		TSet<ElementType> Visited;
+		const auto RadiusSquared = FMath::Square(Radius);
+
+		ForEachCell(GetCell(Center - FVector(Radius)), GetCell(Center + FVector(Radius)), [&](const FIntVector& Cell)
+		{
+			VisitCell(Cell, Visited, OutElements, [&](const FBox& Bounds)
+			{
+				return FMath::SphereAABBIntersection(Center, RadiusSquared, Bounds);
+			});
+		});
+	}
+
+	/**
+	 * Finds the elements whose bounds the segment passes through. Walks the cells along the segment (Amanatides & Woo), so long rays over
+	 * empty space stay cheap.
+	 */
+	void QueryRay(const FVector& Start, const FVector& End, TArray<ElementType>& OutElements) const
+	{
+		TSet<ElementType> Visited;
+		const auto Delta = End - Start;
+		const auto Direction = Delta.GetSafeNormal();
+		const auto Length = Delta.Size();
+
+		auto Cell = GetCell(Start);
+		const auto EndCell = GetCell(End);
+
+		FIntVector Step;
+		FVector NextBoundary;
+		FVector BoundaryStep;
+
+		for (auto Axis = 0; Axis < 3; ++Axis)
+		{
+			if (FMath::IsNearlyZero(Direction[Axis]))
+			{
+				Step[Axis] = 0;
+				NextBoundary[Axis] = TNumericLimits<double>::Max();
+				BoundaryStep[Axis] = TNumericLimits<double>::Max();
+				continue;
+			}
+
+			Step[Axis] = Direction[Axis] > 0 ? 1 : -1;
+
+			const auto Boundary = (Cell[Axis] + (Step[Axis] > 0 ? 1 : 0)) * CellSize;
+			NextBoundary[Axis] = (Boundary - Start[Axis]) / Direction[Axis];
+			BoundaryStep[Axis] = CellSize / FMath::Abs(Direction[Axis]);
+		}
+
+		const auto Intersects = [&](const FBox& Bounds)
+		{
+			return FMath::LineBoxIntersection(Bounds, Start, End, Delta);
+		};
+
+		// Bounded by the cells between the ends, guards against float error never reaching the end cell.
+		const auto MaxSteps = FMath::Abs(EndCell.X - Cell.X) + FMath::Abs(EndCell.Y - Cell.Y) + FMath::Abs(EndCell.Z - Cell.Z) + 1;
+
+		for (auto i = 0; i < MaxSteps; ++i)
+		{
+			VisitCell(Cell, Visited, OutElements, Intersects);
+
+			if (Cell == EndCell)
+			{
+				break;
+			}
+
+			const auto Axis = NextBoundary.X < NextBoundary.Y
+				? (NextBoundary.X < NextBoundary.Z ? 0 : 2)
+				: (NextBoundary.Y < NextBoundary.Z ? 1 : 2);
+
+			if (NextBoundary[Axis] > Length)
+			{
+				break;
+			}
+
+			Cell[Axis] += Step[Axis];
+			NextBoundary[Axis] += BoundaryStep[Axis];
+		}
+	}
+
+	/**
+	 * @return The bounds the element was last updated with, or null if it's not in the grid.
+	 */
+	const FBox* FindBounds(const ElementType& Element) const
+	{
+		const auto* Entry = Entries.Find(Element);
+		return Entry ? &Entry->Bounds : nullptr;
+	}
+
+private:
+	struct FEntry
+	{
+		FBox Bounds;
+		FIntVector MinCell;
+		FIntVector MaxCell;
+	};
+
+	double CellSize;
+	TMap<ElementType, FEntry> Entries;
+	TMap<FIntVector, TArray<ElementType>> Cells;
+
+	FIntVector GetCell(const FVector& Location) const
+	{
+		return FIntVector(
+			FMath::FloorToInt32(Location.X / CellSize),
+			FMath::FloorToInt32(Location.Y / CellSize),
+			FMath::FloorToInt32(Location.Z / CellSize));
+	}
+
+	template <typename FuncType>
+	static void ForEachCell(const FIntVector& MinCell, const FIntVector& MaxCell, FuncType Func)
+	{
+		for (auto X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (auto Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				for (auto Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+				{
+					Func(FIntVector(X, Y, Z));
+				}
+			}
+		}
+	}
+
+	template <typename TestType>
+	void VisitCell(const FIntVector& Cell, TSet<ElementType>& Visited, TArray<ElementType>& OutElements, TestType Test) const
+	{
+		const auto* CellElements = Cells.Find(Cell);
+		if (!CellElements)
+		{
+			return;
+		}
+
+		for (const auto& Element : *CellElements)
+		{
+			bool bAlreadyVisited;
+			Visited.Add(Element, &bAlreadyVisited);
+
+			if (!bAlreadyVisited && Test(Entries.FindChecked(Element).Bounds))
+			{
+				OutElements.Add(Element);
+			}
+		}
+	}
+
+	void RemoveFromCells(const ElementType& Element, const FEntry& Entry)
+	{
+		ForEachCell(Entry.MinCell, Entry.MaxCell, [&](const FIntVector& Cell)
+		{
+			if (auto* CellElements = Cells.Find(Cell))
+			{
+				CellElements->RemoveSingleSwap(Element);
+
+				if (CellElements->IsEmpty())
+				{
+					Cells.Remove(Cell);
+				}
+			}
+		});
+	}
+};
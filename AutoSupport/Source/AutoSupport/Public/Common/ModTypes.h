@@ -32,6 +32,7 @@ struct AUTOSUPPORT_API FAutoSupportBuildableHandle
 
 	explicit FAutoSupportBuildableHandle(AFGBuildable* Buildable);
 	explicit FAutoSupportBuildableHandle(const FLightweightBuildableInstanceRef& LightweightRef);
+	FAutoSupportBuildableHandle(TSubclassOf<AFGBuildable> BuildableClass, const FTransform& Transform);
 
 	/**
 	 * The buildable reference. This can be a non lightweight or lightweight temporary that will get cleaned up.
@@ -53,24 +54,85 @@ protected:
 	FTransform Transform;
 
 	/**
-	 * The cached hash for the rounded transform.
+	 * The Morton (Z-order) key of the location quantized to the handle grid. See MakeLocationKey.
 	 */
 	UPROPERTY(SaveGame)
-	uint32 TransformHash = 0;
+	uint64 LocationKey = 0;
 
 	void SetTransform(const FTransform& NewTransform);
 
 public:
-	static void GetRoundedLocation(const FVector& Location, FInt64Vector3& OutLocation);
+	/**
+	 * Bits per axis of the location key.
+	 */
+	static constexpr int32 LocationKeyAxisBits = 21;
+
+	/**
+	 * Quantizes the location to the handle grid and interleaves the cell coordinates into a Morton key. Cells are offset so the world
+	 * origin sits in the middle of the key range; locations beyond the range are clamped to the edge cells. Equal keys are only a hash
+	 * match, Equals still compares the transforms within the tolerance.
+	 */
+	static uint64 MakeLocationKey(const FVector& Location);
+
+	/**
+	 * Gets the location keys of this handle's cell and of each neighbouring cell within the equality tolerance of the location. The handle's
+	 * own key is always first.
+	 */
+	void GetToleranceProbeKeys(TArray<uint64, TInlineAllocator<8>>& OutKeys) const;
+
+	/**
+	 * Gets the location keys of the location's cell and of each neighbouring cell within the equality tolerance. The location's own key is
+	 * always first.
+	 */
+	static void GetToleranceProbeKeys(const FVector& Location, TArray<uint64, TInlineAllocator<8>>& OutKeys);
+
+	/**
+	 * Finds a handle equal to this one in a handle keyed map or set, also probing the neighbouring grid cells within the equality tolerance.
+	 * @param Container The map or set.
+	 * @param OutMatch The probe that is contained. Use it as the key to look up or remove the entry.
+	 * @return True if found.
+	 */
+	template <typename ContainerType>
+	bool FindInWithTolerance(const ContainerType& Container, FAutoSupportBuildableHandle& OutMatch) const
+	{
+		if (Container.Contains(*this))
+		{
+			OutMatch = *this;
+			return true;
+		}
+
+		TArray<uint64, TInlineAllocator<8>> ProbeKeys;
+		GetToleranceProbeKeys(ProbeKeys);
+
+		auto Probe = *this;
+		
+		for (auto i = 1; i < ProbeKeys.Num(); ++i)
+		{
+			Probe.LocationKey = ProbeKeys[i];
+			
+			if (Container.Contains(Probe))
+			{
+				OutMatch = Probe;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	FORCEINLINE TSubclassOf<AFGBuildable> GetBuildableClass() const
+	{
+		return BuildableClass;
+	}
 
 	FORCEINLINE const FTransform& GetTransform() const
 	{
 		return Transform;
 	}
 
-	FORCEINLINE uint32 GetTransformHash() const
+	FORCEINLINE uint64 GetLocationKey() const
 	{
-		return TransformHash;
+		return LocationKey;
 	}
 	
 	FORCEINLINE bool IsConsideredLightweight() const
@@ -94,12 +156,65 @@ public:
 	{
 		return HashCombine(
 			GetTypeHash(Handle.BuildableClass),
-			Handle.TransformHash);
+			GetTypeHash(Handle.LocationKey));
 	}
 	
 	FString ToString() const;
 };
 
+/**
+ * Compact, versioned save encoding of a proxy's handles. The parts of a proxy share its rotation and lie along one of its axes, so each part
+ * is stored as an index into a class table, an index into a rotation table, and its offset from the proxy quantized to 0.01 cm. A part
+ * that is not at unit scale also stores an index into a scale table, flagged in the low bit of its rotation index. All numbers are zigzag
+ * and packed int encoded.
+ */
+struct AUTOSUPPORT_API FAutoSupportHandleCodec
+{
+	/**
+	 * Version 1 has no scales, its parts decode at unit scale.
+	 */
+	static constexpr uint8 Version = 2;
+
+	/**
+	 * The offset quantization step in cm.
+	 */
+	static constexpr double OffsetQuantum = 0.01;
+
+	/**
+	 * Quantizes the offset to OffsetQuantum, clamped to the int32 range.
+	 */
+	static FIntVector QuantizeOffset(const FVector& Offset);
+
+	static FVector DequantizeOffset(const FIntVector& QuantizedOffset);
+
+	/**
+	 * @param Handles The handles to encode.
+	 * @param BaseTransform The transform the handles are encoded relative to.
+	 * @param OutClasses The class table.
+	 * @param OutBuildables The non-lightweight buildables, referenced by index in the encoded data.
+	 * @param OutData The encoded data.
+	 */
+	static void Encode(
+		const TArray<FAutoSupportBuildableHandle>& Handles,
+		const FTransform& BaseTransform,
+		TArray<TSubclassOf<AFGBuildable>>& OutClasses,
+		TArray<TWeakObjectPtr<AFGBuildable>>& OutBuildables,
+		TArray<uint8>& OutData);
+
+	/**
+	 * @return False if the data could not be decoded. Handles are only output on success.
+	 */
+	static bool Decode(
+		const TArray<uint8>& Data,
+		const FTransform& BaseTransform,
+		const TArray<TSubclassOf<AFGBuildable>>& Classes,
+		const TArray<TWeakObjectPtr<AFGBuildable>>& Buildables,
+		TArray<FAutoSupportBuildableHandle>& OutHandles);
+
+private:
+	static void SerializeSigned(FArchive& Ar, int32& Value);
+};
+
 UENUM(BlueprintType)
 enum class EAutoSupportTraceHitClassification : uint8
 {
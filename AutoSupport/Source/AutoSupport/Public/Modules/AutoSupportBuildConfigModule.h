@@ -41,7 +41,19 @@ public:
 		UContentTagRegistry* ContentTagRegistry,
 		TSubclassOf<UFGConstructDisqualifier>& OutDisqualifier) const;
 
-	
+	/**
+	 * Set to true to build supports of a single part without a support proxy. The part is tracked by the mod subsystem instead so the proxy
+	 * dismantle mode still recognizes it.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	bool bSkipProxyForSinglePartSupports = false;
+
+	/**
+	 * Set to true to store built supports as compact records of a region actor per grid cell, instead of a support proxy actor each. Keeps
+	 * the actor count down in large factories.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	bool bStoreSupportsInRegions = false;
 
 protected:
 	/**
@@ -6,6 +6,12 @@
 #include "FGCharacterPlayer.h"
 #include "AutoSupportBuildGunExtensionsModule.generated.h"
 
+class ABuildableAutoSupport;
+class ABuildableAutoSupportProxy;
+class ABuildableAutoSupportProxyCollision;
+class ABuildableAutoSupportRegion;
+class UFGBuildGunState;
+class UFGBuildGunStateBuild;
 class UFGBuildGunStateDismantle;
 class UAutoSupportBuildGunInputMappingContext;
 class UInputAction;
@@ -13,6 +19,28 @@ class UFGDismantleModeDescriptor;
 class AFGBuildGun;
 class UFGBuildGunModeDescriptor;
 
+/**
+ * The shape the area dismantle mode selects proxies with.
+ */
+UENUM(BlueprintType)
+enum class EAutoSupportAreaDismantleShape : uint8
+{
+	Sphere,
+	Box
+};
+
+/**
+ * The proxies one player's area dismantle mode selected.
+ */
+USTRUCT()
+struct AUTOSUPPORT_API FAutoSupportAreaDismantleSelection
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> Proxies;
+};
+
 /**
  * Child game module that manages build gun extensions. This is spawned via the Blueprint class of AutoSupportGameWorldModule.
  */
@@ -34,6 +62,39 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	TSubclassOf<UFGBuildGunModeDescriptor> ProxyDismantleMode;
 
+	/**
+	 * The extra dismantle mode that dismantles every proxy in an area around the aimed at location.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TSubclassOf<UFGBuildGunModeDescriptor> ProxyAreaDismantleMode;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	EAutoSupportAreaDismantleShape AreaDismantleShape = EAutoSupportAreaDismantleShape::Sphere;
+
+	/**
+	 * The radius of the sphere shaped area.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float AreaDismantleRadius = 2000.f;
+
+	/**
+	 * The half size of the box shaped area.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FVector AreaDismantleExtent = FVector(2000.f, 2000.f, 4000.f);
+
+	/**
+	 * How far from the view the area dismantle mode traces for the area center.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float AreaDismantleTraceDistance = 10000.f;
+
+	/**
+	 * How far from the view the build state looks for an auto support cube to preview.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float BuildPreviewHoverDistance = 5000.f;
+
 	/**
 	 * The additional input mapping context and actions for the build gun in build mode.
 	 */
@@ -43,10 +104,61 @@ public:
 	UPROPERTY(Transient)
 	TSet<TWeakObjectPtr<AFGBuildGun>> HookedBuildGuns;
 
+	/**
+	 * Clears the proxies highlighted by the area dismantle mode.
+	 */
+	void ClearAreaDismantleSelection(AFGCharacterPlayer* Player);
+
 protected:
+	/**
+	 * The proxies selected by the area dismantle mode, by player. Every player in the mode has their own selection on a listen server.
+	 */
+	UPROPERTY(Transient)
+	TMap<TWeakObjectPtr<AFGCharacterPlayer>, FAutoSupportAreaDismantleSelection> AreaDismantleSelections;
+
+	/**
+	 * The cube each local player hovers with the build gun in the build state. Each holds a build preview request on its cube.
+	 */
+	UPROPERTY(Transient)
+	TMap<TWeakObjectPtr<AFGCharacterPlayer>, TWeakObjectPtr<ABuildableAutoSupport>> BuildGunHoveredCubes;
+	
+
 	void OnBuildGunEquip(AFGBuildGun* BuildGun, AFGCharacterPlayer* Player);
 	void OnBuildGunEndPlay(AFGBuildGun* BuildGun, EEndPlayReason::Type Reason);
 	void AppendExtraDismantleModes(TArray<TSubclassOf<UFGBuildGunModeDescriptor>>& OutExtraModes) const;
-	void OnBuildGunDismantleStateTick(UFGBuildGunStateDismantle* State) const;
+	void OnBuildGunDismantleStateTick(UFGBuildGunStateDismantle* State);
+	void OnBuildGunBuildStateTick(UFGBuildGunStateBuild* State);
+	void OnBuildGunBuildStateEnd(UFGBuildGunStateBuild* State);
+
+	/**
+	 * Moves the player's build preview request to the cube, if it's not already on it. Null removes it.
+	 */
+	void SetBuildGunHoveredCube(AFGCharacterPlayer* Player, ABuildableAutoSupport* Cube);
+
+	/**
+	 * @return True if the area dismantle mode handled the fire and the default dismantle should not run.
+	 */
+	bool OnBuildGunDismantlePrimaryFire(UFGBuildGunStateDismantle* State);
+
+	/**
+	 * Sends the region record the player aims at to the server to dismantle.
+	 * @return True, the vanilla dismantle should not run for regions.
+	 */
+	bool DismantleAimedRegionRecord(UFGBuildGunStateDismantle* State, ABuildableAutoSupportRegion* Region);
+
+	void TickAreaDismantle(UFGBuildGunStateDismantle* State);
+
+	/**
+	 * Resolves the region record under the view, to highlight it and to send it to the server when fired.
+	 */
+	void TickRegionDismantle(UFGBuildGunStateDismantle* State, ABuildableAutoSupportRegion* Region);
+
+	/**
+	 * @return The proxy whose instance in the shared collision is under the view, or null.
+	 */
+	ABuildableAutoSupportProxy* TraceProxyCollision(const UFGBuildGunStateDismantle* State, const ABuildableAutoSupportProxyCollision* Collision) const;
+	void UpdateAreaDismantleSelection(const TArray<ABuildableAutoSupportProxy*>& Proxies, AFGCharacterPlayer* Player);
+	static AFGCharacterPlayer* GetDismantlingPlayer(const UFGBuildGunStateDismantle* State);
+	static AFGCharacterPlayer* GetBuildGunPlayer(const UFGBuildGunState* State);
 	
 };
@@ -16,6 +16,8 @@ public:
 	
 	template <class TChildModule>
 	static TChildModule* GetChild(const UWorld* World, FName ChildModuleName);
+
+	virtual void DispatchLifecycleEvent(ELifecyclePhase Phase) override;
 };
 
 template <typename TChildModule>
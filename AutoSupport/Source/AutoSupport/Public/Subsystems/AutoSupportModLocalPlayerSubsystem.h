@@ -11,6 +11,7 @@
 
 class AFGCharacterPlayer;
 class AFGBuildGun;
+class ABuildableAutoSupportRegion;
 
 UCLASS()
 class AUTOSUPPORT_API UAutoSupportModLocalPlayerSubsystem : public ULocalPlayerSubsystem
@@ -26,6 +27,7 @@ public:
 	UAutoSupportModLocalPlayerSubsystem();
 	
 	void SyncProxyWithBuildGunState(ABuildableAutoSupportProxy* Proxy) const;
+	void SyncRegionWithBuildGunState(ABuildableAutoSupportRegion* Region) const;
 
 	virtual void PlayerControllerChanged(APlayerController* NewPlayerController) override;
 	
@@ -42,6 +44,20 @@ protected:
 
 	UPROPERTY(Transient)
 	bool IsAutoBuildKeyHeld = false;
+
+	/**
+	 * The build mode the queued proxies are being updated to.
+	 */
+	UPROPERTY(Transient)
+	TSubclassOf<UFGBuildGunModeDescriptor> PendingBuildMode;
+
+	/**
+	 * Proxies still to be updated to PendingBuildMode, nearest last so they pop first.
+	 */
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> PendingBuildModeUpdates;
+
+	FTimerHandle BuildModeUpdateTimerHandle;
 	
 	AFGCharacterPlayer* GetPlayerCharacter() const;
 	AFGBuildGun* GetBuildGun() const;
@@ -57,5 +73,11 @@ protected:
 	void OnAutoBuildSupportsKeyStarted();
 	void OnAutoBuildSupportsKeyCompleted();
 
-	void AsyncUpdateAllProxiesBuildMode(TSubclassOf<UFGBuildGunModeDescriptor> ModeDescriptor) const;
+	/**
+	 * Updates every proxy to the build mode. Proxies near the player update right away, the rest are queued by distance and updated a
+	 * budgeted number per frame. Proxies already in the mode are skipped. Regions are few, they all update right away.
+	 */
+	void AsyncUpdateAllProxiesBuildMode(TSubclassOf<UFGBuildGunModeDescriptor> ModeDescriptor);
+
+	void ProcessPendingBuildModeUpdates();
 };
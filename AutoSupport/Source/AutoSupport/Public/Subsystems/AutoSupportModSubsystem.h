@@ -4,13 +4,96 @@
 
 #include "CoreMinimal.h"
 #include "FGSaveInterface.h"
+#include "Common/ModBloomFilter.h"
+#include "Common/ModDefines.h"
+#include "Common/ModSpatialGrid.h"
 #include "Common/ModTypes.h"
 #include "Buildables/BuildableAutoSupport_Types.h"
+#include "Buildables/BuildableAutoSupportRegion.h"
+#include "Engine/StreamableManager.h"
 #include "SML/Public/Subsystem/ModSubsystem.h"
 #include "AutoSupportModSubsystem.generated.h"
 
+class AFGCharacterPlayer;
 class UAutoSupportBuildConfig;
 class ABuildableAutoSupportProxy;
+class ABuildableAutoSupportProxyCollision;
+class UFGRecipe;
+
+/**
+ * The handles registered to a proxy. Wrapped so it can be a map value.
+ */
+USTRUCT()
+struct AUTOSUPPORT_API FAutoSupportProxyHandleSet
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSet<FAutoSupportBuildableHandle> Handles;
+};
+
+/**
+ * What a compaction sweep over the proxies did.
+ */
+struct FAutoSupportCompactionStats
+{
+	int32 NumProxiesVisited = 0;
+	int32 NumProxiesSkipped = 0;
+	int32 NumDeadHandles = 0;
+	int32 NumDuplicateHandles = 0;
+	int32 NumEmptyProxiesDestroyed = 0;
+	double StartTime = 0;
+};
+
+/**
+ * What an audit of the registered handles found.
+ */
+struct FAutoSupportAuditStats
+{
+	int32 NumHandlesChecked = 0;
+	int32 NumHealthy = 0;
+
+	/**
+	 * Lightweight handles whose instance ref was stale, relinked to an instance found within tolerance.
+	 */
+	int32 NumRepaired = 0;
+
+	/**
+	 * Links to proxies, regions or region records that no longer exist. Removed.
+	 */
+	int32 NumOrphanedLinks = 0;
+
+	/**
+	 * Handles whose buildable or lightweight instance no longer exists. Flagged only, see Orphans.
+	 */
+	int32 NumMissingBuildables = 0;
+	int32 NumMissingInstances = 0;
+
+	/**
+	 * Handles of proxies still being resolved, checked by the next audit.
+	 */
+	int32 NumSkipped = 0;
+
+	TArray<FAutoSupportBuildableHandle> Orphans;
+	double StartTime = 0;
+	double EndTime = 0;
+};
+
+/**
+ * The parts removed from a proxy, gathered over a frame.
+ */
+struct FAutoSupportProxyRemovedParts
+{
+	TWeakObjectPtr<ABuildableAutoSupportProxy> Proxy;
+	TArray<FAutoSupportBuildableHandle> Handles;
+};
+
+/**
+ * Proxy events are batched over a frame and broadcast once from the subsystem tick. Destroyed proxies are passed as the stale weak pointers
+ * they were, which still compare equal to the ones subscribers hold.
+ */
+DECLARE_MULTICAST_DELEGATE_OneParam(FAutoSupportProxyBatchDelegate, const TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>>& /* Proxies */);
+DECLARE_MULTICAST_DELEGATE_OneParam(FAutoSupportProxyPartsRemovedDelegate, const TArray<FAutoSupportProxyRemovedParts>& /* RemovedParts */);
 
 UCLASS(Abstract, Blueprintable)
 class AUTOSUPPORT_API AAutoSupportModSubsystem : public AModSubsystem, public IFGSaveInterface
@@ -20,15 +103,209 @@ class AUTOSUPPORT_API AAutoSupportModSubsystem : public AModSubsystem, public IF
 	friend class UAutoSupportModLocalPlayerSubsystem;
 	
 public:
+	AAutoSupportModSubsystem();
+	
 	static AAutoSupportModSubsystem* Get(const UWorld* World);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/**
+	 * Proxies registered or re-registered with the subsystem, including loaded proxies once resolved. Proxies destroyed in the same frame
+	 * are left out.
+	 */
+	FAutoSupportProxyBatchDelegate OnProxiesRegistered;
+
+	FAutoSupportProxyBatchDelegate OnProxiesDestroyed;
+
+	/**
+	 * Handles dropped from proxies that remain, either dismantled or found dead by compaction. Proxies emptied by the removal are destroyed
+	 * and reported by OnProxiesDestroyed instead.
+	 */
+	FAutoSupportProxyPartsRemovedDelegate OnProxyPartsRemoved;
+
+	/**
+	 * Loaded proxies whose lightweight handles were resolved. The load resolve is finished once IsLoadResolvePending returns false.
+	 */
+	FAutoSupportProxyBatchDelegate OnProxiesLoadResolved;
+
+	FORCEINLINE bool IsLoadResolvePending() const
+	{
+		return !PendingLightweightResolves.IsEmpty();
+	}
 	
 	void RegisterProxy(ABuildableAutoSupportProxy* Proxy);
 	void RegisterHandleToProxyLink(const FAutoSupportBuildableHandle& Handle, ABuildableAutoSupportProxy* Proxy);
 	
 	void OnProxyDestroyed(const ABuildableAutoSupportProxy* Proxy);
 
+	/**
+	 * Moves the proxy in the spatial index after its bounds changed.
+	 */
+	void UpdateProxyBounds(ABuildableAutoSupportProxy* Proxy);
+
+	/**
+	 * Finds the proxies whose world bounds intersect the box.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void GetProxiesInBox(const FBox& Box, TArray<ABuildableAutoSupportProxy*>& OutProxies) const;
+
+	/**
+	 * Finds the proxies whose world bounds intersect the sphere.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void GetProxiesInRadius(const FVector& Center, float Radius, TArray<ABuildableAutoSupportProxy*>& OutProxies) const;
+
+	/**
+	 * Finds the proxies whose world bounds the segment passes through.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void GetProxiesAlongRay(const FVector& Start, const FVector& End, TArray<ABuildableAutoSupportProxy*>& OutProxies) const;
+
+	/**
+	 * @return True if proxies are aimed at through the shared per cell collision actors rather than their own bounding box.
+	 */
+	FORCEINLINE bool UsesSharedProxyCollision() const
+	{
+		return ProxyCollisionClass != nullptr;
+	}
+
+	/**
+	 * Tracks whether the local player is in the proxy dismantle mode. The shared proxy collision is only enabled while any player is.
+	 */
+	void SetProxyDismantleModeActive(const ULocalPlayer* LocalPlayer, bool bActive);
+
+	/**
+	 * Queues a loaded proxy to have its lightweight handles resolved. Queued proxies are resolved nearest to the players first: those within
+	 * AUTOSUPPORT_LOAD_RESOLVE_IMMEDIATE_RADIUS on the next tick, the rest a budgeted number per tick.
+	 */
+	void QueueLightweightResolve(ABuildableAutoSupportProxy* Proxy);
+
+	/**
+	 * Resolves a queued proxy right away, out of its turn.
+	 */
+	void ResolveLightweightsNow(ABuildableAutoSupportProxy* Proxy);
+
+	/**
+	 * Queues a proxy's open dismantle transaction to be committed on the next tick. The handles it removed are then unlinked in one batch.
+	 */
+	void QueueDismantleCommit(ABuildableAutoSupportProxy* Proxy);
+
+	/**
+	 * Logs the cost of exact and tolerance lookups in ProxyByBuildable. Uses a synthetic map if the world has no supports.
+	 */
+	void BenchmarkHandleLookups(int32 Iterations) const;
+
+	/**
+	 * Logs the bytes per part of the proxies at runtime, held as handles with keyed lightweight refs before and in the part layout now. The
+	 * size of the save encoding is logged next to them for comparison, it is not a runtime layout.
+	 */
+	void LogHandleMemoryReport() const;
+
+	/**
+	 * Starts an audit of the registered handles if none is running. Audits also start on their own periodically.
+	 * @param bLogSummary True to log the summary at Display verbosity when done.
+	 */
+	void StartAudit(bool bLogSummary);
+
+	/**
+	 * Logs the summary of the last completed audit.
+	 */
+	void LogLastAuditSummary() const;
+
+	/**
+	 * Tracks a support that was built as a single part without a proxy.
+	 */
+	void RegisterSinglePartSupport(AFGBuildable* Buildable);
+
+	/**
+	 * @return True if the buildable is a support built as a single part without a proxy.
+	 */
+	bool IsSinglePartSupport(AFGBuildable* Buildable) const;
+
+	/**
+	 * A cheap, conservative check of whether the buildable could be linked to a proxy, a region record or be a single part support. Cheap
+	 * enough to call for every buildable removed from the world. False means it is definitely not linked.
+	 */
+	bool MayBeRegistered(const AFGBuildable* Buildable) const;
+
 	UFUNCTION()
 	void OnWorldBuildableRemoved(AFGBuildable* Buildable);
+
+	/**
+	 * @return The recipe that builds the buildable class, from a table of the available build recipes. Null if there is none.
+	 */
+	TSubclassOf<UFGRecipe> GetBuildRecipe(TSubclassOf<AFGBuildable> BuildableClass);
+
+	/**
+	 * Sums the build costs of the handles' buildables into a refund, without needing the buildables to exist as actors.
+	 * @param Handles The handles to refund.
+	 * @param OutRefund The refund, one stack per item.
+	 */
+	void GetHandlesRefund(const TArray<FAutoSupportBuildableHandle>& Handles, TArray<FInventoryStack>& OutRefund);
+
+	/**
+	 * Keeps the proxies that may be dismantled together in one batch. A proxy is kept if it can be dismantled and has no dismantle
+	 * disqualifier with the whole selection selected. Proxies whose parts also belong to a blueprint are left to be dismantled with the
+	 * blueprint or on their own, the blueprint would refund them too.
+	 * @param Proxies The selected proxies.
+	 * @param OutProxies The proxies that may be dismantled.
+	 */
+	static void FilterDismantleableProxies(const TArray<ABuildableAutoSupportProxy*>& Proxies, TArray<ABuildableAutoSupportProxy*>& OutProxies);
+
+	/**
+	 * Dismantles the proxies in one batch. The refund of all of them is computed once from their handles and given to the player, with
+	 * whatever doesn't fit in a crate. Proxies that FilterDismantleableProxies does not keep are skipped. Needs authority.
+	 * @param SelectedProxies The proxies to dismantle.
+	 * @param Player The player receiving the refund.
+	 */
+	void DismantleProxies(const TArray<ABuildableAutoSupportProxy*>& SelectedProxies, AFGCharacterPlayer* Player);
+
+	/**
+	 * Stores a built support as a record of the region of its cell, spawning the region if the cell has none yet.
+	 * @param RegionClass The region class to spawn.
+	 * @param SupportTransform The world transform the support was built relative to.
+	 * @param LocalBounds The bounds of the support relative to SupportTransform.
+	 * @param Buildables The built parts.
+	 * @return The region the support was added to.
+	 */
+	ABuildableAutoSupportRegion* AddSupportToRegion(
+		TSubclassOf<ABuildableAutoSupportRegion> RegionClass,
+		const FTransform& SupportTransform,
+		const FBox& LocalBounds,
+		const TArray<AFGBuildable*>& Buildables);
+
+	/**
+	 * Links every record of a region that began play.
+	 */
+	void RegisterRegion(ABuildableAutoSupportRegion* Region);
+	void OnRegionDestroyed(const ABuildableAutoSupportRegion* Region);
+
+	void LinkRegionRecord(ABuildableAutoSupportRegion* Region, const FAutoSupportRegionRecord& Record);
+	void UnlinkRegionHandles(const TArray<FAutoSupportBuildableHandle>& Handles);
+
+	UFUNCTION(BlueprintCallable)
+	void GetRegions(TArray<ABuildableAutoSupportRegion*>& OutRegions) const;
+
+	/**
+	 * Dismantles the handles' parts, spawning temporaries for the lightweight ones. Used for records, whose lightweight parts have no
+	 * resolved instance refs.
+	 */
+	void DismantleHandleParts(const TArray<FAutoSupportBuildableHandle>& Handles);
+
+	/**
+	 * Gives a dismantle refund to the player, with whatever doesn't fit in a crate. Needs authority.
+	 * @param Player The player receiving the refund.
+	 * @param Refund The refund, summed before the parts were dismantled.
+	 * @param CrateLocation Where the crate spawns if the inventory is full.
+	 */
+	void GiveDismantleRefund(AFGCharacterPlayer* Player, const TArray<FInventoryStack>& Refund, const FVector& CrateLocation);
+
+	/**
+	 * Asynchronously loads every descriptor referenced by the data. The loaded descriptors are kept loaded for the lifetime of the subsystem.
+	 * @param Data The data referencing the descriptors.
+	 * @param OnLoaded Called when every referenced descriptor finished loading. Called immediately if nothing needs loading.
+	 */
+	void PreloadDescriptors(const FBuildableAutoSupportData& Data, FStreamableDelegate OnLoaded = FStreamableDelegate());
 	
 #pragma region IFGSaveInterface
 	
@@ -109,20 +386,282 @@ protected:
 	UPROPERTY(VisibleInstanceOnly, SaveGame)
 	TMap<FString, FBuildableAutoSupportData> AutoSupportPresets;
 
+	/**
+	 * Supports built as a single part without a proxy.
+	 */
+	UPROPERTY(VisibleInstanceOnly, SaveGame)
+	TSet<FAutoSupportBuildableHandle> SinglePartSupports;
+
 	/**
 	 * This is used to respond to deletion events on the buildables and notify the proxy a buildable it contains has been destroyed.
 	 */
 	UPROPERTY(Transient)
 	TMap<FAutoSupportBuildableHandle, TWeakObjectPtr<ABuildableAutoSupportProxy>> ProxyByBuildable;
 
+	/**
+	 * The reverse of ProxyByBuildable so a proxy's handles can be found without walking every handle.
+	 */
+	UPROPERTY(Transient)
+	TMap<TWeakObjectPtr<ABuildableAutoSupportProxy>, FAutoSupportProxyHandleSet> HandlesByProxy;
+
 	/**
 	 * All the world proxies.
 	 */
 	UPROPERTY(Transient)
 	TSet<TWeakObjectPtr<ABuildableAutoSupportProxy>> AllProxies;
+
+	/**
+	 * The world proxies indexed by their world bounds.
+	 */
+	TAutoSupportSpatialGrid<TWeakObjectPtr<ABuildableAutoSupportProxy>> ProxyGrid { AUTOSUPPORT_PROXY_GRID_CELL_SIZE };
+
+	/**
+	 * The actor class holding the shared proxy collision of a region grid cell. If none, each proxy collides with its own bounding box.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Auto Support")
+	TSubclassOf<ABuildableAutoSupportProxyCollision> ProxyCollisionClass;
+
+	/**
+	 * The shared proxy collision actors by region grid cell.
+	 */
+	UPROPERTY(Transient)
+	TMap<FIntVector, TObjectPtr<ABuildableAutoSupportProxyCollision>> ProxyCollisionByCell;
+
+	/**
+	 * The cell each proxy has its collision instance in.
+	 */
+	TMap<TWeakObjectPtr<const ABuildableAutoSupportProxy>, FIntVector> ProxyCollisionCellByProxy;
+
+	/**
+	 * The local players in the proxy dismantle mode.
+	 */
+	TSet<TWeakObjectPtr<const ULocalPlayer>> ProxyDismantleModePlayers;
+
+	/**
+	 * The streamable handles keeping the loaded descriptors in memory, by descriptor path.
+	 */
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> DescriptorLoadHandles;
+
+	/**
+	 * Loaded proxies waiting for their lightweight handles to be resolved.
+	 */
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> PendingLightweightResolves;
+
+	/**
+	 * The available build recipes by the buildable class they build. Rebuilt when a class is missing and the available recipes changed.
+	 */
+	UPROPERTY(Transient)
+	TMap<TSubclassOf<AFGBuildable>, TSubclassOf<UFGRecipe>> BuildRecipeByClass;
+
+	int32 NumAvailableRecipesAtTableBuild = INDEX_NONE;
+
+	/**
+	 * The proxies left to visit in the current compaction sweep.
+	 */
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> CompactionQueue;
+
+	FAutoSupportCompactionStats CompactionStats;
+	FAutoSupportCompactionStats LastCompactionStats;
+
+	/**
+	 * When the last compaction sweep finished, in world seconds.
+	 */
+	double LastCompactionEndTime = 0;
+
+	/**
+	 * When the world was last saved, in world seconds. Negative until the first save.
+	 */
+	double LastSaveTime = -1;
+
+	/**
+	 * The time between the last two saves, the autosave interval unless the player saved by hand. Zero until two saves were seen.
+	 */
+	double ObservedSaveInterval = 0;
+
+	/**
+	 * The handles left to check in the running audit.
+	 */
+	UPROPERTY(Transient)
+	TArray<FAutoSupportBuildableHandle> AuditQueue;
+
+	/**
+	 * Lightweight instance runtime indexes by instance handle, built per class on demand for the running audit.
+	 */
+	TMap<TSubclassOf<AFGBuildable>, TMap<FAutoSupportBuildableHandle, int32>> AuditInstanceIndex;
+
+	/**
+	 * Like AuditInstanceIndex, kept while loaded proxies are waiting to be resolved.
+	 */
+	TMap<TSubclassOf<AFGBuildable>, TMap<FAutoSupportBuildableHandle, int32>> LoadResolveInstanceIndex;
+
+	/**
+	 * True when proxies were queued since PendingLightweightResolves was last sorted by distance.
+	 */
+	bool bLoadResolveQueueDirty = false;
+
+	FAutoSupportAuditStats AuditStats;
+	FAutoSupportAuditStats LastAuditStats;
+	bool bHasCompletedAudit = false;
+	bool bLogAuditSummary = false;
+
+	/**
+	 * Proxies with an open dismantle transaction.
+	 */
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> PendingDismantleCommits;
+
+	/**
+	 * The proxy events of the frame, broadcast by BroadcastProxyEvents.
+	 */
+	TSet<TWeakObjectPtr<ABuildableAutoSupportProxy>> PendingRegisteredEvents;
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> PendingDestroyedEvents;
+	TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>> PendingLoadResolvedEvents;
+	TMap<TWeakObjectPtr<ABuildableAutoSupportProxy>, TArray<FAutoSupportBuildableHandle>> PendingPartsRemovedEvents;
+
+	/**
+	 * The world regions by their region grid cell.
+	 */
+	UPROPERTY(Transient)
+	TMap<FIntVector, TWeakObjectPtr<ABuildableAutoSupportRegion>> RegionsByCell;
+
+	/**
+	 * The region counterpart of ProxyByBuildable.
+	 */
+	UPROPERTY(Transient)
+	TMap<FAutoSupportBuildableHandle, FAutoSupportRegionRecordRef> RegionRecordByBuildable;
 	
 	virtual void Init() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void PreloadSavedDescriptors();
+	void OnSavedDescriptorsLoaded();
+	void RequestDescriptorLoads(const TArray<FSoftObjectPath>& Paths, FStreamableDelegate OnLoaded);
+
+	void ResolvePendingLightweights();
+	void ResolveProxyLightweights(ABuildableAutoSupportProxy* Proxy);
+
+	/**
+	 * @return True if a player pawn exists to prioritize the load resolves around.
+	 */
+	bool GetLoadResolveFocus(FVector& OutLocation) const;
+
+	/**
+	 * Finds the lightweight instance of the handle within tolerance, building the index of its class on first use. The class is reindexed
+	 * once if the indexed instance no longer matches, runtime indexes can change as instances are added and removed.
+	 */
+	bool FindIndexedLightweightInstance(
+		TMap<TSubclassOf<AFGBuildable>, TMap<FAutoSupportBuildableHandle, int32>>& IndexByClass,
+		const FAutoSupportBuildableHandle& Handle,
+		FLightweightBuildableInstanceRef& OutInstanceRef) const;
+
+	void RebuildBuildRecipeTable();
+
+	void UpdateProxyCollision(ABuildableAutoSupportProxy* Proxy);
+	void RemoveProxyCollision(const ABuildableAutoSupportProxy* Proxy);
+
+	FORCEINLINE bool IsProxyCollisionActive() const
+	{
+		return !ProxyDismantleModePlayers.IsEmpty();
+	}
+
+	static void GetValidProxies(const TArray<TWeakObjectPtr<ABuildableAutoSupportProxy>>& Proxies, TArray<ABuildableAutoSupportProxy*>& OutProxies);
+
+	void CommitPendingDismantles();
+
+	/**
+	 * Broadcasts the proxy events gathered since the last tick.
+	 */
+	void BroadcastProxyEvents();
+
+	/**
+	 * Compacts a budgeted number of proxies, starting a new sweep once the interval since the last one passed or ahead of an expected save.
+	 * Keeps the saves free of dead handles and empty proxies without a hitch at save time.
+	 */
+	void TickCompaction();
+
+	/**
+	 * @return True if the next save is expected before a sweep started now would finish, and no sweep has finished for it yet. Predicted
+	 * from the interval between the last two saves.
+	 */
+	bool IsSaveExpectedSoon(double Now) const;
+
+	/**
+	 * Compacts the rest of the running sweep at once, when saving. Empty proxies are left for the next sweep to destroy, nothing is
+	 * destroyed while the save is being gathered.
+	 */
+	void FlushCompaction();
+
+	/**
+	 * @param bDestroyIfEmpty False to leave the proxy in place even if compaction emptied it.
+	 */
+	void CompactProxy(ABuildableAutoSupportProxy* Proxy, bool bDestroyIfEmpty = true);
+
+	/**
+	 * Checks a budgeted number of registered handles against their buildables and the lightweight instances, starting a new audit once the
+	 * interval since the last one passed.
+	 */
+	void TickAudit();
+	void AuditHandle(const FAutoSupportBuildableHandle& Handle);
+	void AuditProxyHandle(const FAutoSupportBuildableHandle& Handle, const TWeakObjectPtr<ABuildableAutoSupportProxy>& WeakProxy);
+	void AuditRegionHandle(const FAutoSupportBuildableHandle& Handle, const FAutoSupportRegionRecordRef& RecordRef);
+
+	/**
+	 * Checks a handle that keeps no lightweight ref of its own, a single part support or a region record part. There is nothing to repair,
+	 * the lightweight instance is only looked up.
+	 */
+	void AuditUnreferencedHandle(const FAutoSupportBuildableHandle& Handle);
+	void FinishAudit();
+	static void LogAuditSummary(const FAutoSupportAuditStats& Stats, ELogVerbosity::Type Verbosity);
+	void OnRegionBuildableRemoved(const AFGBuildable* Buildable, const FAutoSupportBuildableHandle& Handle);
+	void UnlinkHandles(const ABuildableAutoSupportProxy* Proxy, const TArray<FAutoSupportBuildableHandle>& Handles);
+
+	/**
+	 * Adds the handle to the removal filter, rebuilding the filter at a larger size once it is over capacity. The handle must already be in
+	 * the map or set it is registered in.
+	 */
+	void AddToRemovalFilter(const FAutoSupportBuildableHandle& Handle);
+
+	/**
+	 * Rebuilds the removal filter from the registered handles, sized for their count. Drops the keys of removed handles, which the filter
+	 * cannot remove on its own.
+	 */
+	void RebuildRemovalFilter();
+
+	static uint64 MakeRemovalFilterKey(const UClass* BuildableClass, uint64 LocationKey);
+
+	/**
+	 * Publishes the subsystem of the world to the lock free fast path of Get. Must hold CachedSubsystemLookupLock.
+	 */
+	static void PublishFastPath(const UWorld* World, AAutoSupportModSubsystem* Subsystem);
+
+	/**
+	 * Clears the fast path if it is the world's. Must hold CachedSubsystemLookupLock.
+	 */
+	static void ClearFastPath(const UWorld* World);
 
 	static TMap<TWeakObjectPtr<const UWorld>, TWeakObjectPtr<AAutoSupportModSubsystem>> CachedSubsystemLookup;
 	static FCriticalSection CachedSubsystemLookupLock;
+
+	/**
+	 * The last published world and its subsystem, read by Get without the lock. Written under a sequence lock: the sequence is odd while a
+	 * write is in progress, and a read is only trusted if the sequence was even and unchanged around it. The world's object serial number
+	 * guards against a new world reusing a destroyed world's address. Serial numbers are never reused, unlike object indices.
+	 */
+	static std::atomic<uint32> FastPathSequence;
+	static std::atomic<const UWorld*> FastPathWorld;
+	static std::atomic<int32> FastPathWorldSerial;
+	static std::atomic<AAutoSupportModSubsystem*> FastPathSubsystem;
+
+	/**
+	 * The classes of every handle registered since the removal filter was last rebuilt. The first reject in MayBeRegistered.
+	 */
+	TSet<const UClass*> RemovalFilterClasses;
+
+	/**
+	 * The class and location keys of every handle registered since the removal filter was last rebuilt. Only grows until rebuilt, so it
+	 * stays conservative as handles are removed. Rebuilt once over capacity and after each compaction sweep.
+	 */
+	TAutoSupportBloomFilter<> RemovalFilter;
 };
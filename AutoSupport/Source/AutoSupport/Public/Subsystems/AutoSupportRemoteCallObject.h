@@ -0,0 +1,41 @@
+﻿// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FGRemoteCallObject.h"
+#include "AutoSupportRemoteCallObject.generated.h"
+
+class ABuildableAutoSupportRegion;
+class AFGCharacterPlayer;
+
+/**
+ * Carries the mod's player requests to the server. Registered by the root game world module.
+ */
+UCLASS()
+class AUTOSUPPORT_API UAutoSupportRemoteCallObject : public UFGRemoteCallObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * @return The remote call object of the player's controller, or null.
+	 */
+	static UAutoSupportRemoteCallObject* Get(const AFGCharacterPlayer* Player);
+
+	/**
+	 * Dismantles the region record the player aimed at and confirmed on their client. The refund and the dismantle are both resolved from
+	 * this one record id, so they cannot disagree and do not depend on the player's view as replicated to the server.
+	 */
+	UFUNCTION(Server, Reliable)
+	void Server_DismantleRegionRecord(ABuildableAutoSupportRegion* Region, int32 RecordId);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+	/**
+	 * Remote call objects need a replicated property to be replicated at all.
+	 */
+	UPROPERTY(Replicated)
+	bool bDummy = true;
+};